@@ -0,0 +1,235 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "simulate.h"
+#include "level.h"
+
+// Shared parts of the checks, which compare the engine with the expected outputs of the example solutions
+// in data/expected. The expected outputs are written by write_expected, and were first written by the
+// engine before it was optimized, so this header only uses what that engine already had.
+
+namespace puzzle {
+
+constexpr int MAX_CYCLES = 999;
+// random test cases for each example
+constexpr size_t RANDOM_TEST_CASES = 200;
+constexpr size_t MAX_RANDOM_STEPS = 6;
+// cycle limits of the expected runs
+constexpr std::array<size_t, 4> RUN_CYCLES = {MAX_CYCLES, 0, 7, 50};
+
+inline std::string read(const std::string &filename) {
+  std::ifstream file(filename);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+// Everything observable about a board after a cycle
+inline std::string state(const Board &board) {
+  std::stringstream ss;
+  ss << board.get_cycle() << " " << board.get_test_case() << " " << board.get_step() << " "
+    << board.get_was_next() << " " << static_cast<int>(board.check_status()) << " " << board.get_error() << std::endl;
+  for (const auto &line : board.get_cells()) {
+    for (const Cell &cell : line) {
+      ss << cell << cell.value << (cell.latched ? 'L' : '.');
+    }
+    ss << std::endl;
+  }
+  for (const Bot &bot : board.get_bots()) {
+    ss << bot.location << bot.moving << bot.holding << " ";
+  }
+  for (const Output &output : board.get_outputs()) {
+    ss << output.power;
+  }
+  ss << std::endl;
+  return ss.str();
+}
+
+// FNV-1a hash of the state, which is what the expected outputs keep of it
+inline uint64_t state_hash(const Board &board) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (const char c : state(board)) hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  return hash;
+}
+
+// How a run ended
+struct Outcome {
+  bool passed = false;
+  bool error = false; // the second result of run
+  size_t cycles = 0;
+  ErrorReason reason = ErrorReason::NONE;
+  std::string text;
+  bool operator==(const Outcome &oth) const {
+    return passed == oth.passed && error == oth.error && cycles == oth.cycles && reason == oth.reason && text == oth.text;
+  }
+  bool operator!=(const Outcome &oth) const { return !(*this == oth); }
+  friend std::ostream& operator<<(std::ostream &os, const Outcome &outcome) {
+    return os << (outcome.passed ? "passed" : "failed") << " after " << outcome.cycles << " cycles" <<
+      (outcome.text.empty() ? "" : " (" + outcome.text + ")");
+  }
+};
+
+inline Outcome outcome(const Board &board, std::pair<bool, bool> result) {
+  return {result.first, result.second, board.get_cycle(), board.get_error_reason(), board.get_error()};
+}
+
+// Outcomes of the expected runs of an example
+struct Expected {
+  // state hash of each cycle of stepping through the test cases like run
+  std::vector<uint64_t> states;
+  // each test case of the level run on its own
+  std::vector<Outcome> test_cases;
+  // random test cases with the colors of the level, and each of them run on its own
+  std::vector<std::vector<std::string>> random_bits;
+  std::vector<std::string> random_colors;
+  std::vector<Outcome> random_test_cases;
+  // all the test cases of the level, then all the random ones, run for each of RUN_CYCLES, and their final state hash
+  std::vector<Outcome> runs;
+  std::vector<uint64_t> run_states;
+};
+
+// data/expected/<solution>.txt for data/example_solutions/<solution>.sol
+inline std::string expected_filename(const std::string &solution_filename) {
+  const size_t name = solution_filename.find_last_of('/') + 1;
+  const size_t directory = solution_filename.find_last_of('/', name >= 2 ? name - 2 : 0);
+  const std::string root = directory == std::string::npos ? "" : solution_filename.substr(0, directory + 1);
+  const std::string stem = solution_filename.substr(name, solution_filename.find_last_of('.') - name);
+  return root + "expected/" + stem + ".txt";
+}
+
+// Layout of the expected outputs, with a line for each state hash (in hex), outcome and random test case:
+// states <count>, hashes, test_cases <count>, outcomes, random <count>, for each the colors and input bits on a line
+// followed by the outcome, and runs <count>, outcomes each followed by the final state hash.
+// An outcome is passed, error, cycles, reason and the rest of the line is the error text.
+inline void write_outcome(std::ostream &os, const Outcome &outcome) {
+  os << outcome.passed << " " << outcome.error << " " << outcome.cycles << " " << static_cast<int>(outcome.reason) <<
+    " " << outcome.text << std::endl;
+}
+
+inline bool read_outcome(std::istream &is, Outcome *outcome) {
+  std::string line;
+  int reason = 0;
+  if (!std::getline(is, line)) return true;
+  std::stringstream ss(line);
+  if (!(ss >> outcome->passed >> outcome->error >> outcome->cycles >> reason) || ss.get() != ' ') return true;
+  outcome->reason = static_cast<ErrorReason>(reason);
+  std::getline(ss, outcome->text);
+  return false;
+}
+
+inline void write_expected(std::ostream &os, const Expected &expected) {
+  os << std::hex << std::setfill('0');
+  os << "states " << std::dec << expected.states.size() << std::hex << std::endl;
+  for (const uint64_t hash : expected.states) os << std::setw(16) << hash << std::endl;
+  os << std::dec;
+  os << "test_cases " << expected.test_cases.size() << std::endl;
+  for (const Outcome &outcome : expected.test_cases) write_outcome(os, outcome);
+  os << "random " << expected.random_test_cases.size() << std::endl;
+  for (size_t t=0; t<expected.random_test_cases.size(); ++t) {
+    os << expected.random_colors[t];
+    for (const std::string &bits : expected.random_bits[t]) os << " " << bits;
+    os << std::endl;
+    write_outcome(os, expected.random_test_cases[t]);
+  }
+  os << "runs " << expected.runs.size() << std::endl;
+  for (size_t i=0; i<expected.runs.size(); ++i) {
+    write_outcome(os, expected.runs[i]);
+    os << std::hex << std::setw(16) << expected.run_states[i] << std::dec << std::endl;
+  }
+}
+
+// Return true if the expected outputs are missing or malformed
+inline bool read_expected(std::istream &is, Expected *expected) {
+  std::string line, heading;
+  size_t count = 0;
+  const auto read_heading = [&](const char *name) {
+    return !std::getline(is, line) || !(std::stringstream(line) >> heading >> count) || heading != name;
+  };
+  const auto read_hash = [&](uint64_t *hash) {
+    return !std::getline(is, line) || !(std::stringstream(line) >> std::hex >> *hash);
+  };
+  if (read_heading("states")) return true;
+  expected->states.resize(count);
+  for (uint64_t &hash : expected->states) {
+    if (read_hash(&hash)) return true;
+  }
+  if (read_heading("test_cases")) return true;
+  expected->test_cases.resize(count);
+  for (Outcome &outcome : expected->test_cases) {
+    if (read_outcome(is, &outcome)) return true;
+  }
+  if (read_heading("random")) return true;
+  expected->random_bits.resize(count);
+  expected->random_colors.resize(count);
+  expected->random_test_cases.resize(count);
+  for (size_t t=0; t<count; ++t) {
+    if (!std::getline(is, line)) return true;
+    std::stringstream ss(line);
+    ss >> expected->random_colors[t];
+    for (std::string bits; ss >> bits;) expected->random_bits[t].push_back(bits);
+    if (read_outcome(is, &expected->random_test_cases[t])) return true;
+  }
+  if (read_heading("runs")) return true;
+  expected->runs.resize(count);
+  expected->run_states.resize(count);
+  for (size_t i=0; i<count; ++i) {
+    if (read_outcome(is, &expected->runs[i]) || read_hash(&expected->run_states[i])) return true;
+  }
+  return false;
+}
+
+// Copy of the board running the given test cases from the start
+inline Board with_test_cases(const Board &board, const std::vector<std::vector<std::string>> &bits,
+    const std::vector<std::string> &colors) {
+  Board copy = board;
+  copy.set_input_bits(bits);
+  copy.set_output_colors(colors);
+  copy.reset_and_validate();
+  return copy;
+}
+
+// Run the check on each example solution given as level and solution files with its expected outputs,
+// and return the exit status, reporting the number of mismatches the checks return
+inline int check_examples(int argc, char *argv[], const char *name,
+    const std::function<int(const Board &board, const Expected &expected, const std::string &example)> &check) {
+  if (argc < 3 || argc % 2 == 0) {
+    std::cerr << "Args: level_file submission_file [level_file submission_file ...]" << std::endl;
+    return 1;
+  }
+  int failures = 0;
+  for (int i=1; i<argc; i+=2) {
+    const Board board = load(read(argv[i]), read(argv[i+1]));
+    if (board.check_status() == Status::INVALID) {
+      std::cout << argv[i+1] << ": invalid board: " << board.get_error() << std::endl;
+      ++failures;
+      continue;
+    }
+    Expected expected;
+    std::ifstream file(expected_filename(argv[i+1]));
+    if (read_expected(file, &expected)) {
+      std::cout << argv[i+1] << ": no expected outputs in " << expected_filename(argv[i+1]) << std::endl;
+      ++failures;
+      continue;
+    }
+    failures += check(board, expected, argv[i+1]);
+  }
+  if (failures) {
+    std::cout << name << " failed: " << failures << " mismatches" << std::endl;
+    return 1;
+  }
+  std::cout << name << ": all examples match" << std::endl;
+  return 0;
+}
+
+} // namespace puzzle
+#endif // CHECK_H_
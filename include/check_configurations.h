@@ -0,0 +1,65 @@
+#ifndef CHECK_CONFIGURATIONS_H_
+#define CHECK_CONFIGURATIONS_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "simulate.h"
+
+namespace puzzle {
+
+// Board configurations that have to resolve like the engine the expected outputs were written with
+inline const std::vector<std::pair<std::string, std::function<void(Board&)>>> CONFIGURATIONS = {
+  {"full", [](Board &board) {
+    board.set_incremental_resolve(false);
+    board.set_resolve_cache_size(0);
+    board.set_resolve_pairs(false);
+    board.set_resolve_constants(false);
+  }},
+  {"incremental", [](Board &board) {}},
+  {"incremental without cache", [](Board &board) { board.set_resolve_cache_size(0); }},
+  {"full with pairs", [](Board &board) {
+    board.set_incremental_resolve(false);
+    board.set_resolve_cache_size(0);
+  }},
+  {"single entry cache", [](Board &board) { board.set_resolve_cache_size(1); }},
+  {"parallel", [](Board &board) { board.set_resolve_threads(4, 0); }},
+  {"parallel without cache", [](Board &board) {
+    board.set_resolve_cache_size(0);
+    board.set_resolve_threads(4, 0);
+  }},
+  // differential test of the resolve engines
+  {"worklist", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::WORKLIST);
+    board.set_resolve_cache_size(0);
+  }},
+  {"full worklist", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::WORKLIST);
+    board.set_incremental_resolve(false);
+    board.set_resolve_cache_size(0);
+  }},
+  {"parallel worklist", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::WORKLIST);
+    board.set_resolve_cache_size(0);
+    board.set_resolve_threads(4, 0);
+  }},
+  {"bitboard", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::BITBOARD);
+    board.set_resolve_cache_size(0);
+  }},
+  {"full bitboard", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::BITBOARD);
+    board.set_incremental_resolve(false);
+    board.set_resolve_cache_size(0);
+  }},
+  {"parallel bitboard", [](Board &board) {
+    board.set_resolve_engine(ResolveEngine::BITBOARD);
+    board.set_resolve_cache_size(0);
+    board.set_resolve_threads(4, 0);
+  }},
+};
+
+} // namespace puzzle
+#endif // CHECK_CONFIGURATIONS_H_
@@ -4,12 +4,45 @@
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 #include "simulate.h"
 
 namespace puzzle {
 
+// Single pass reader over the text of a level or submission file, which keeps its position for errors
+class Parser {
+  std::string_view text;
+  size_t pos = 0;
+  size_t line = 1;
+  size_t line_start = 0;
+  size_t value_line = 1;
+  size_t value_column = 1;
+
+  void advance(size_t count);
+  void skip_space();
+  // remember the position of the next character as the start of a value
+  void start_value();
+public:
+  Parser(std::string_view text) : text(text) {}
+  // 1-based position of the next character
+  size_t get_line() const { return line; }
+  size_t get_column() const { return pos - line_start + 1; }
+  // 1-based position of the start of the last value read
+  size_t get_value_line() const { return value_line; }
+  size_t get_value_column() const { return value_column; }
+  // read a non-negative integer, and return true if there is none
+  bool integer(int &value);
+  // read a whitespace separated token, and return true if there is none
+  bool token(std::string_view &value);
+  // skip the rest of the current line
+  void skip_line();
+  // read a grid of m lines of n squares after any blank lines, and return true if it does not fit,
+  // leaving the position at the first square off the grid
+  bool grid(size_t m, size_t n, std::string_view &value);
+};
+
 // parse grid
 std::string get_grid(std::istream &is, int m);
 // print line
@@ -18,6 +51,7 @@ bool show(std::ostream *os, const std::string &line);
 bool verify(std::istream &is_level, std::istream &is_submission, std::ostream *os, bool print_board=true);
 
 // load from level and submission
+Board load(std::string_view level, std::string_view submission, std::ostream *os);
 Board load(std::istream &is_level, std::istream &is_submission, std::ostream *os);
 Board load(const std::string &level, const std::string &submission);
 
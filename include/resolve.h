@@ -1,6 +1,263 @@
 #ifndef RESOLVE_H_
 #define RESOLVE_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "simulate.h"
 
+namespace puzzle {
+
+enum R_ {
+  // r^2 distances where cell side length is 2
+  R0, // same offset cell
+  R4, // adjacent cells
+  R5, // 1x1 next to offset cell
+  R8, // kitty corner
+  R9, // 1x1 next to offset cell lengthwise
+  R10, // adjacent offset cells in opposite directions
+  R13, // 1x1 kitty corner to offset cell
+  R16, // distance 2
+  R17, // distance 2 sideways from offset cell
+  R20, // distance (2, 1)
+  MAXR, // number of elements of R
+};
+class R {
+  R_ r;
+public:
+  constexpr R() : r(R_::R0) {}
+  constexpr R(R_ r) : r(r) {}
+  constexpr R(size_t r) : r(static_cast<R_>(r)) {}
+  operator R_() const { return r; }
+  int v() const {
+    switch (*this) {
+    case R0: return 0;
+    case R4: return 4;
+    case R5: return 5;
+    case R8: return 8;
+    case R9: return 9;
+    case R10: return 10;
+    case R13: return 13;
+    case R16: return 16;
+    case R17: return 17;
+    case R20: return 20;
+    case MAXR: default: return -1;
+    }
+  }
+  static constexpr R FromInt(uint8_t d) {
+    switch (d) {
+    case 0: return R0;
+    case 4: return R4;
+    case 5: return R5;
+    case 8: return R8;
+    case 9: return R9;
+    case 10: return R10;
+    case 13: return R13;
+    case 16: return R16;
+    case 17: return R17;
+    case 20: return R20;
+    default: return MAXR;
+    }
+  }
+};
+
+// Nodes for cell resolution stored as parallel arrays
+// Each square has a node and an antinode (for the opposite value) for each R,
+// numbered so that related nodes are found arithmetically.
+class Nodes {
+public:
+  using Index = uint32_t;
+  static constexpr Index NONE = ~Index(0);
+  // needs to be max size for single distance plus 1
+  static constexpr int MAX_DEGREE = 9;
+
+  // Identity
+  const size_t squares;
+  static Index index(size_t square, R r, bool anti) { return (square * MAXR + r) << 1 | anti; }
+  static size_t square(Index node) { return node / (2 * MAXR); }
+  static R r(Index node) { return (node >> 1) % MAXR; }
+  static bool anti(Index node) { return node & 1; }
+  // link to node for opposite value
+  static Index antinode(Index node) { return node ^ 1; }
+  // node for decrease in R (higher priority)
+  static Index higher(Index node) { return r(node) > 0 ? node - 2 : NONE; }
+  // node for increase in R (lower priority)
+  static Index lower(Index node) { return r(node) + 1 < MAXR ? node + 2 : NONE; }
+  // Constant cells share the R0 node of their value, placed after the squares
+  // These nodes are always complete and are never materialized.
+  static constexpr size_t CONSTANTS = 4; // one for each Cell::Value_
+  Index constant(Cell::Value value) const {
+    return index(squares + static_cast<size_t>(static_cast<Cell::Value_>(value)), R0, false);
+  }
+
+  // Edges
+  std::vector<Index> sources; // MAX_DEGREE per node
+  std::vector<uint8_t> nsources;
+  Index* sources_of(Index node) { return &sources[node * MAX_DEGREE]; }
+  // Values
+  std::vector<Cell::Value> value;
+
+  // Bookkeeping for Tarjan's algorithm
+  struct State {
+    int index;
+    int lowlink;
+    uint8_t source_index;
+    bool on_stack;
+    bool in_subcall;
+    bool use_lower;
+  };
+  std::vector<State> state;
+
+  // Lazy construction
+  // A priority level of a square is only constructed when it is first referenced,
+  // and is valid for the resolve whose epoch matches its stamp.
+  uint32_t epoch = 0;
+  std::vector<uint32_t> stamp; // (square, r)
+  bool materialized(Index node) const { return stamp[node >> 1] == epoch; }
+  // invalidate all nodes except the constant ones
+  void next_epoch() {
+    if (++epoch == 0) {
+      std::fill(stamp.begin(), stamp.end(), 0);
+      epoch = 1;
+    }
+    for (size_t value=0; value<CONSTANTS; ++value) stamp[(squares + value) * MAXR] = epoch;
+  }
+
+  Nodes(size_t squares) :
+      squares(squares),
+      sources((squares + CONSTANTS) * 2 * MAXR * MAX_DEGREE),
+      nsources((squares + CONSTANTS) * 2 * MAXR),
+      value((squares + CONSTANTS) * 2 * MAXR),
+      state((squares + CONSTANTS) * 2 * MAXR),
+      stamp((squares + CONSTANTS) * MAXR) {
+    for (size_t v=0; v<CONSTANTS; ++v) {
+      const Index node = constant(static_cast<Cell::Value_>(v));
+      value[node] = static_cast<Cell::Value_>(v);
+      value[antinode(node)] = -value[node];
+      state[node].index = state[antinode(node)].index = 1;
+    }
+  }
+};
+
+// Memory for resolving clusters, one per resolving thread
+struct WorkerStacks {
+  // Tarjan's algorithm
+  std::vector<Nodes::Index> callstack;
+  std::vector<Nodes::Index> scc;
+  std::vector<Nodes::Index> scc_initial;
+  // propagation over the strongly connected components of the cells
+  struct CellState {
+    int index = 0;
+    int lowlink = 0;
+    uint8_t source_index = 0;
+    bool on_stack = false;
+    bool signed_ = false;
+    bool anti = false; // sign in a contracted component
+  };
+  std::vector<CellState> cell_state; // square
+  std::vector<Square> cell_callstack;
+  std::vector<Square> cell_scc;
+  std::vector<Square> queue;
+};
+
+// Planes of the cells decided in bulk by a resolve, laid out like CellPlanes
+struct Bitboard {
+  std::vector<uint64_t> candidates; // unlatched 1x1 cells with only 1x1 cells in range
+  // resolved cells, starting from the latched cells, and their values
+  std::vector<uint64_t> known;
+  std::vector<uint64_t> ones;
+  std::vector<uint64_t> zeros;
+
+  Bitboard(size_t m) :
+      candidates(m + 2 * CellPlanes::PADDING + CellPlanes::ROWS),
+      known(candidates.size()),
+      ones(candidates.size()),
+      zeros(candidates.size()) {}
+};
+
+// Persistent threads for running independent jobs
+// The calling thread is worker 0 and takes part in the work.
+class WorkerPool {
+public:
+  // reference to a callable taking the worker and the job, which unlike std::function never allocates
+  // The callable has to outlive the reference.
+  class Job {
+    const void *callable;
+    void (*call)(const void *callable, size_t worker, size_t job);
+  public:
+    template<typename F>
+    Job(const F &f) :
+      callable(&f),
+      call([](const void *callable, size_t worker, size_t job) { (*static_cast<const F*>(callable))(worker, job); }) {}
+    void operator()(size_t worker, size_t job) const { call(callable, worker, job); }
+  };
+
+  WorkerPool(size_t nworkers);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  size_t size() const { return threads.size() + 1; }
+  // call job for each of the jobs and return once all of them are done
+  void run(size_t njobs, const Job &job);
+
+private:
+  void take_jobs(size_t worker);
+  void work(size_t worker);
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  const Job *job = nullptr;
+  size_t njobs = 0;
+  std::atomic<size_t> next_job{0};
+  size_t generation = 0;
+  size_t active = 0;
+  bool stop = false;
+};
+
+// Preallocated memory for resolving and moving a board
+// Each board owns one, so separate boards can be run concurrently.
+class Workspace {
+public:
+  const size_t m, n;
+  // flat offsets of the squares in range, indexed like the bits of Influences
+  std::array<int, Influences::WIDTH * Influences::WIDTH> offsets;
+  // cells to resolve
+  Grid<bool> in_region;
+  std::vector<Square> region;
+  // end of each independent cluster in the region
+  std::vector<size_t> clusters;
+  // lanes still to resolve for each cluster, and the clusters with any
+  std::vector<uint64_t> pending_lanes; // cluster
+  std::vector<size_t> lane_clusters;
+  // Tarjan's algorithm
+  Nodes nodes;
+  Bitboard bitboard;
+  std::vector<WorkerStacks> stacks; // worker
+  std::unique_ptr<WorkerPool> pool;
+  // chain of cells to move
+  std::vector<Location> moving;
+  // number of held cells moving into each square, zero between moves
+  Grid<uint8_t> claims;
+
+  Workspace(size_t m, size_t n);
+  // make sure there are stacks for the workers
+  void add_stacks(size_t nworkers);
+};
+
+// Resolve the R0 nodes of a cluster of cells, given as ascending squares, with Tarjan's algorithm
+// Nodes already completed are kept, and the rest must be from the current epoch or unconstructed.
+void resolve_cluster(Nodes &nodes, const Grid<Influences> &influences, const Grid<Cell> &cells,
+    WorkerStacks &stacks, const Square *begin, const Square *end);
+
+} // namespace puzzle
 #endif // RESOLVE_H_
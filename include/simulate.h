@@ -1,10 +1,16 @@
 #ifndef SIMULATE_H_
 #define SIMULATE_H_
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 
@@ -21,6 +27,8 @@ namespace puzzle {
 
 
 constexpr int sqr(int x) { return x * x; }
+constexpr int RANGE = 2; // max range of 2 cells in each dimension
+constexpr size_t CACHE_LINE = 64;
 
 
 class Formatter {
@@ -43,20 +51,36 @@ enum class ErrorReason {
   RUNTIME_ERROR,
   WRONG_OUTPUT,
   TOO_MANY_CYCLES,
+  INFINITE_LOOP,
 };
 
 
+// Error with a static message, whose text is only formatted with the arguments when it is read,
+// so errors are raised without allocating. Errors from elsewhere, such as snapshots, keep their text.
 class Error {
-  std::string error;
+  const char *message = nullptr; // printf format taking the arguments as size_t
+  std::array<size_t, 2> args{};
+  std::string text;
   ErrorReason reason{};
+  // 1-based position in the text the error was read from, or 0 if it is unknown
+  size_t line = 0, column = 0;
+  // square of the grid passed to a setter where the error is, counted from the start of the grid
+  size_t y = 0, x = 0;
 public:
   Error() {}
-  Error(const std::string &error, ErrorReason reason=ErrorReason::RUNTIME_ERROR) : error(error), reason(reason) {}
-  operator std::string() const { return error; }
-  operator bool() const { return !error.empty(); }
+  Error(const char *message, ErrorReason reason=ErrorReason::RUNTIME_ERROR, size_t arg0=0, size_t arg1=0) :
+    message(message), args{arg0, arg1}, reason(reason) {}
+  Error(const std::string &error, ErrorReason reason=ErrorReason::RUNTIME_ERROR) : text(error), reason(reason) {}
+  operator std::string() const;
+  operator bool() const { return message || !text.empty(); }
   ErrorReason error_reason() const { return reason; }
-  bool operator==(const Error &oth) const { return error == oth.error; }
-  bool operator!=(const Error &oth) const { return !(error == oth.error); }
+  // the same error at a square of the grid it was raised for
+  Error in_square(size_t y, size_t x) const;
+  // the same error at a 1-based position of the text it was read from, or for an error in a square of a grid,
+  // at that square of the grid starting at the position
+  Error at(size_t line, size_t column) const;
+  bool operator==(const Error &oth) const;
+  bool operator!=(const Error &oth) const { return !(*this == oth); }
 
   // TODO: remove
   // Error& operator=(const Error &error) { this->error = error.error;  throw std::runtime_error(this->error); }
@@ -65,6 +89,8 @@ public:
   static const Error InvalidInput;
   static const Error InvalidLevelFormat;
   static const Error OutOfRange;
+  static Error TooManyCycles(size_t max_cycles);
+  static Error InfiniteLoop(size_t cycle, size_t period);
 };
 
 
@@ -107,7 +133,7 @@ public:
 };
 
 
-enum class Direction_ {
+enum class Direction_ : uint8_t {
   NONE,
   LEFT,
   DOWN,
@@ -127,6 +153,7 @@ public:
     return os << static_cast<char>(direction);
   }
 };
+inline std::ostream& operator<<(std::ostream &os, Direction_ direction) { return os << Direction(direction); }
 
 
 struct Location {
@@ -158,6 +185,35 @@ struct Location {
 };
 
 
+// Flat index y * n + x of a square in a grid with n columns
+// The engine uses it internally in place of Location, whose arithmetic checks validity.
+using Square = uint32_t;
+
+
+// Cells around a square that interact with the cell in it, which only depends
+// on the geometry of the cells and not on their values
+struct Influences {
+  struct Source {
+    int8_t dy = 0;
+    int8_t dx = 0;
+    uint8_t r = 0; // priority of the edge
+    bool anti = false; // anticorrelated
+  };
+  static constexpr int WIDTH = 2 * RANGE + 1;
+  static constexpr int MAX_SOURCES = sqr(WIDTH) - 1;
+  // neighbors affecting the cell in row-major order
+  uint8_t nsources = 0;
+  std::array<Source, MAX_SOURCES> sources;
+  // bit (dy + RANGE) * WIDTH + (dx + RANGE) is set if the cells affect each other in either direction
+  uint32_t linked = 0;
+  // same bits set for the sources only
+  uint32_t sourced = 0;
+  // same bits set for the sources that are constant cells, which are not linked
+  uint32_t fixed = 0;
+  static constexpr uint32_t bit(int dy, int dx) { return 1 << ((dy + RANGE) * WIDTH + (dx + RANGE)); }
+};
+
+
 enum Path_ {};
 struct Path {
   enum {
@@ -187,7 +243,7 @@ struct Output {
 
 class Cell {
 public:
-  enum class Value_ {
+  enum class Value_ : uint8_t {
     UNKNOWN,
     ZERO,
     ONE,
@@ -215,23 +271,29 @@ public:
 
   };
 
-  bool exists = false;
-  bool x = false; // x or +
-  bool latched = false;
-  bool offset = false;
+  friend std::ostream& operator<<(std::ostream &os, Value_ value) { return os << Value(value); }
+
+  // bit fields, so that a cell takes 3 bytes
+  bool exists : 1;
+  bool x : 1; // x or +
+  bool latched : 1;
+  bool offset : 1;
+  // partial state
+  bool held : 1;
+  bool rotating : 1;
+  bool refreshing : 1;
   // for diodes, direction is the direction of the diode
   // for offset cells, direction is the side from the cell center
-  Direction direction;
-  Location partner_delta; // dy, dx to partner
-  Value value;
+  Direction_ direction : 3;
+  Direction_ partner : 3; // side of the partner
   // partial state
-  Value previous_value;
-  Direction moving;
-  bool held = false;
-  bool rotating = false;
-  bool refreshing = false;
+  Direction_ moving : 3;
+  Value_ value : 2;
+  Value_ previous_value : 2;
 
-  constexpr Cell() {}
+  constexpr Cell() : exists(false), x(false), latched(false), offset(false), held(false), rotating(false),
+    refreshing(false), direction(Direction_::NONE), partner(Direction_::NONE), moving(Direction_::NONE),
+    value(Value_::UNKNOWN), previous_value(Value_::UNKNOWN) {}
   Cell(char c) : Cell(_Cell(c)) {}; // does not account for diode cells
   // Producers
   static Cell UnlatchedCell(bool x);
@@ -246,17 +308,19 @@ public:
   explicit operator Color() const;
 
   // State checkers
-  bool is_1x1() const { return exists && !partner_delta; }
+  Location partner_delta() const { return Location(partner); } // dy, dx to partner
+  bool is_1x1() const { return exists && partner == Direction_::NONE; }
   bool is_grabbable() const { return is_1x1(); }
   bool is_latchable() const { return is_1x1(); }
   bool is_refreshable() const { return is_1x1() && latched; }
   bool is_rotateable() const { return is_1x1(); }
-  bool is_diode() const { return direction && !offset; }
+  bool is_diode() const { return direction != Direction_::NONE && !offset; }
 
 
 private:
   static Cell _Cell(char c); // dispatcher
 };
+static_assert(sizeof(Cell) <= 4, "grids of cells are copied at every test case");
 
 
 class Operation {
@@ -371,16 +435,71 @@ struct Bot {
 };
 
 
+// Vector that keeps its capacity when copied, for buffers reserved up front so running does not allocate
 template<typename T>
+class ReservedVector : public std::vector<T> {
+public:
+  using std::vector<T>::vector;
+  using std::vector<T>::operator=;
+  ReservedVector() {}
+  ReservedVector(const ReservedVector &oth) { *this = oth; }
+  ReservedVector(ReservedVector &&oth) = default;
+  ReservedVector& operator=(const ReservedVector &oth) {
+    this->reserve(oth.capacity());
+    this->assign(oth.begin(), oth.end());
+    return *this;
+  }
+  ReservedVector& operator=(ReservedVector &&oth) = default;
+};
+
+
+// Allocator aligning each allocation to a cache line
+template<typename T>
+struct CacheAlignedAllocator {
+  using value_type = T;
+  CacheAlignedAllocator() = default;
+  template<typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+  T* allocate(size_t count) {
+    return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(CACHE_LINE)));
+  }
+  void deallocate(T *p, size_t) { ::operator delete(p, std::align_val_t(CACHE_LINE)); }
+  template<typename U>
+  bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+  template<typename U>
+  bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+// Split the next line off the text of a grid, without its newline
+inline std::string_view next_line(std::string_view &text) {
+  const size_t end = std::min(text.find('\n'), text.size());
+  const std::string_view line = text.substr(0, end);
+  text.remove_prefix(std::min(end + 1, text.size()));
+  return line;
+}
+
+// Square of the text of a grid, where '_' is an alternative to ' '
+constexpr char grid_char(char c) { return c == '_' ? ' ' : c; }
+
+
+// Grid of m rows and n columns surrounded by a halo of default squares
+// A square is an index into the storage including the halo, so locations up to the halo width off
+// the board can be read without bounds checks and neighbors of a square are at fixed offsets.
+template<typename T, typename Allocator=CacheAlignedAllocator<T>>
 class Grid {
-  size_t m, n;
-  T* data = nullptr;
+  using Traits = std::allocator_traits<Allocator>;
+  size_t m = 0, n = 0;
+  size_t border = 0; // halo width
+  size_t width = 0; // stride between rows
+  T* data = nullptr; // storage including the halo
+  T* origin = nullptr; // square at row 0 and column 0
+  Allocator allocator;
   template<typename U>
   class GridRow {
-    size_t n;
+    size_t n, stride;
     U* row;
   public:
-    GridRow(int n, U *row) : n(n), row(row) {}
+    GridRow(size_t n, size_t stride, U *row) : n(n), stride(stride), row(row) {}
     size_t size() const { return n; }
     const U& operator[](size_t x) const { return row[x]; }
     U& operator[](size_t x) { return const_cast<U&>(std::as_const(*this)[x]); }
@@ -390,7 +509,7 @@ class Grid {
     U* end() { return const_cast<U*>(std::as_const(*this).end()); }
     bool operator==(const GridRow &oth) const { return row == oth.row; }
     bool operator!=(const GridRow &oth) const { return !(*this == oth); }
-    GridRow& operator++() { row += n; return *this; }
+    GridRow& operator++() { row += stride; return *this; }
     const U& operator*() const { return *row; }
     U& operator*() { return const_cast<U&>(*std::as_const(*this)); }
   };
@@ -398,70 +517,99 @@ class Grid {
   class GridIterator {
     GridRow<U> grow;
   public:
-    GridIterator(int n, U *row) : grow(n, row) {}
+    GridIterator(size_t n, size_t stride, U *row) : grow(n, stride, row) {}
     const GridRow<U>& operator*() const { return grow; }
     GridRow<U>& operator*() { return const_cast<GridRow<U>&>(*std::as_const(*this)); }
     GridIterator& operator++() { ++grow; return *this; }
     bool operator==(const GridIterator &oth) const { return grow == oth.grow; }
     bool operator!=(const GridIterator &oth) const { return !(*this == oth); }
   };
+
+  void allocate(size_t m, size_t n, size_t halo) {
+    this->m = m;
+    this->n = n;
+    border = halo;
+    width = n + 2 * halo;
+    data = squares() ? Traits::allocate(allocator, squares()) : nullptr;
+    for (size_t i=0; i<squares(); ++i) Traits::construct(allocator, data + i);
+    origin = data + border * width + border;
+  }
+  void deallocate() {
+    if (!data) return;
+    for (size_t i=0; i<squares(); ++i) Traits::destroy(allocator, data + i);
+    Traits::deallocate(allocator, data, squares());
+    data = origin = nullptr;
+  }
+  void take(Grid &grid) {
+    m = grid.m;
+    n = grid.n;
+    border = grid.border;
+    width = grid.width;
+    data = grid.data;
+    origin = grid.origin;
+    grid.m = grid.n = grid.border = grid.width = 0;
+    grid.data = grid.origin = nullptr;
+  }
 public:
-  Grid(size_t m, size_t n) : m(m), n(n), data(new T[m*n]) {}
-  ~Grid() { delete[] data; }
-  Grid(const Grid &grid) : m(grid.m), n(grid.n), data(new T[m*n]) {
-    for (size_t i=0; i<size(); ++i) data[i] = grid.data[i];
+  Grid(size_t m, size_t n, size_t halo=0) { allocate(m, n, halo); }
+  ~Grid() { deallocate(); }
+  Grid(const Grid &grid) : allocator(grid.allocator) {
+    allocate(grid.m, grid.n, grid.border);
+    std::copy(grid.data, grid.data + squares(), data);
   }
   Grid& operator=(const Grid &grid) {
-    if (size() != grid.size()) {
-      delete[] data;
-      data = new T[grid.m*grid.n];
+    if (this == &grid) return *this;
+    // reuse the allocation only for the same geometry
+    if (m != grid.m || n != grid.n || border != grid.border) {
+      deallocate();
+      allocate(grid.m, grid.n, grid.border);
     }
-    m = grid.m;
-    n = grid.n;
-    for (size_t i=0; i<size(); ++i) data[i] = grid.data[i];
+    std::copy(grid.data, grid.data + squares(), data);
     return *this;
   }
-  Grid(Grid &&grid) : m(grid.m), n(grid.n), data(grid.data) {
-    grid.m = 0;
-    grid.n = 0;
-    grid.data = nullptr;
-  }
+  Grid(Grid &&grid) { take(grid); }
   Grid& operator=(Grid &&grid) {
-    delete[] data;
-    m = grid.m;
-    n = grid.n;
-    data = grid.data;
-    grid.m = 0;
-    grid.n = 0;
-    grid.data = nullptr;
+    if (this == &grid) return *this;
+    deallocate();
+    take(grid);
     return *this;
   }
 
   size_t size() const { return m*n; }
   size_t rows() const { return m; }
   size_t cols() const { return n; }
+  size_t halo() const { return border; }
+  size_t stride() const { return width; }
+  // number of squares including the halo
+  size_t squares() const { return (m + 2 * border) * width; }
 
   bool valid(const Location &location) const {
     return location && 0 <= location.y && location.y < (int) m && 0 <= location.x && location.x < (int) n;
   }
+  Square square(const Location &location) const { return (location.y + border) * width + location.x + border; }
+  Location location(Square square) const {
+    return Location(static_cast<int>(square / width) - border, static_cast<int>(square % width) - border);
+  }
 
-  GridRow<const T> operator[](size_t y) const { return GridRow<const T>(n, data + y*n); }
-  GridRow<T> operator[](size_t y) { return GridRow<T>(n, data + y*n); }
-  const T& at(size_t y, size_t x) const { return data[y*n+x]; }
+  GridRow<const T> operator[](size_t y) const { return GridRow<const T>(n, width, origin + y*width); }
+  GridRow<T> operator[](size_t y) { return GridRow<T>(n, width, origin + y*width); }
+  const T& at(size_t y, size_t x) const { return origin[y*width+x]; }
   T& at(size_t y, size_t x) { return const_cast<T&>(std::as_const(*this).at(y, x)); }
-  const T& at(const Location &location) const { return at(location.y, location.x); }
+  const T& at(const Location &location) const { return origin[location.y * static_cast<int>(width) + location.x]; }
   T& at(const Location &location) { return const_cast<T&>(std::as_const(*this).at(location)); }
+  const T& at(Square square) const { return data[square]; }
+  T& at(Square square) { return data[square]; }
 
-  GridIterator<const T> begin() const { return GridIterator<const T>(n, data); }
-  GridIterator<T> begin() { return GridIterator<T>(n, data); }
-  GridIterator<const T> end() const { return GridIterator<const T>(n, data + m*n); }
-  GridIterator<T> end() { return GridIterator<T>(n, data + m*n); }
+  GridIterator<const T> begin() const { return GridIterator<const T>(n, width, origin); }
+  GridIterator<T> begin() { return GridIterator<T>(n, width, origin); }
+  GridIterator<const T> end() const { return GridIterator<const T>(n, width, origin + m*width); }
+  GridIterator<T> end() { return GridIterator<T>(n, width, origin + m*width); }
 
   template<typename Q=T>
   typename std::enable_if<std::is_same<Q, Cell>::value, const T*>::type partner(const Location &location) const {
     const T& cell = this->at(location);
-    if (cell.partner_delta) {
-      Location partner_location = location + cell.partner_delta;
+    if (cell.partner_delta()) {
+      Location partner_location = location + cell.partner_delta();
       if (this->valid(partner_location)) return &this->at(partner_location);
     }
     return nullptr;
@@ -471,23 +619,28 @@ public:
     return const_cast<T*>(std::as_const(*this).partner(location));
   }
 
-  void memset(char c) { std::memset(data, c, size() * sizeof(*data)); }
+  // the halo keeps its default squares
+  void memset(char c) {
+    for (size_t y=0; y<m; ++y) std::memset(origin + y*width, c, n * sizeof(*data));
+  }
   bool reset() { return reset(T()); }
   bool reset(const T &v) {
-    for (size_t i=0; i<size(); ++i) data[i] = v;
+    for (size_t y=0; y<m; ++y) std::fill(origin + y*width, origin + y*width + n, v);
     return false;
   }
   // return true if input error
-  bool reset(const std::string &grid) {
-    std::stringstream ss(grid);
-    std::string line;
+  // set from the text of a grid, and return true if it does not fit, with the square where it stops fitting
+  bool reset(std::string_view grid, Location *mismatch=nullptr) {
     for (size_t y=0; y<m; ++y) {
-      std::getline(ss, line);
-      if (line.size() != n) return true;
-      for (size_t x=0; x<n; ++x) this->at(y, x) = line[x];
+      const std::string_view line = next_line(grid);
+      if (line.size() != n) {
+        if (mismatch) *mismatch = Location(y, std::min(line.size(), n));
+        return true;
+      }
+      for (size_t x=0; x<n; ++x) this->at(y, x) = grid_char(line[x]);
     }
-    if (ss.peek() != EOF) return true;
-    return false;
+    if (mismatch) *mismatch = Location(m, 0);
+    return !grid.empty();
   }
 
   friend std::ostream& operator<<(std::ostream &os, const Grid &grid) {
@@ -502,6 +655,185 @@ public:
 };
 
 
+// Values of a cell in up to 64 lanes, with one mask for each bit of Cell::Value_
+struct LaneValue {
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+  constexpr LaneValue() {}
+  // the same value in every lane
+  LaneValue(Cell::Value value) {
+    const uint8_t v = static_cast<uint8_t>(static_cast<Cell::Value_>(value));
+    lo = -static_cast<uint64_t>(v & 1);
+    hi = -static_cast<uint64_t>(v >> 1);
+  }
+  Cell::Value get(size_t lane) const { return static_cast<Cell::Value_>((lo >> lane & 1) | (hi >> lane & 1) << 1); }
+  // copy the lanes of the mask from another value
+  void set(uint64_t lanes, const LaneValue &value) {
+    lo = (lo & ~lanes) | (value.lo & lanes);
+    hi = (hi & ~lanes) | (value.hi & lanes);
+  }
+  // lanes where the values differ
+  uint64_t differ(const LaneValue &oth) const { return (lo ^ oth.lo) | (hi ^ oth.hi); }
+  // lanes with the value
+  uint64_t is(Cell::Value value) const { return ~differ(value); }
+  // ZERO and ONE are the values with a single bit set
+  LaneValue operator-() const {
+    LaneValue negated;
+    negated.lo = hi;
+    negated.hi = lo;
+    return negated;
+  }
+};
+
+constexpr size_t LANES = 64;
+
+// Outcome of simulating a test case on its own
+struct LaneResult {
+  bool passed = false;
+  size_t cycles = 0;
+  Error error;
+  bool operator==(const LaneResult &oth) const { return passed == oth.passed && cycles == oth.cycles && error == oth.error; }
+  bool operator!=(const LaneResult &oth) const { return !(*this == oth); }
+};
+
+
+// Bit planes of the rows of a board of up to 64 columns, kept up to date with the squares that change
+// Bit x of a row is the square in column x, and the planes are padded with empty rows.
+struct CellPlanes {
+  static constexpr size_t MAX_COLS = 64;
+  // most rows read at once past the last row of the board
+  static constexpr size_t ROWS = 4;
+  // first row of the board
+  static constexpr size_t PADDING = RANGE;
+  std::vector<uint64_t> xs; // 1x1 x cells
+  std::vector<uint64_t> pluses; // 1x1 + cells
+  std::vector<uint64_t> others; // cells larger than 1x1
+  std::vector<uint64_t> latched; // latched 1x1 cells
+  // previous values of the 1x1 cells, where neither is set for undefined
+  std::vector<uint64_t> ones;
+  std::vector<uint64_t> zeros;
+
+  CellPlanes(size_t m) :
+      xs(m + 2 * PADDING + ROWS),
+      pluses(xs.size()),
+      others(xs.size()),
+      latched(xs.size()),
+      ones(xs.size()),
+      zeros(xs.size()) {}
+  // set the bits of the square in row y and column x from its cell
+  void set(size_t y, size_t x, const Cell &cell) {
+    const size_t row = y + PADDING;
+    const uint64_t bit = uint64_t(1) << x;
+    for (std::vector<uint64_t> *plane : {&xs, &pluses, &others, &latched, &ones, &zeros}) (*plane)[row] &= ~bit;
+    if (!cell) return;
+    if (!cell.is_1x1()) {
+      others[row] |= bit;
+      return;
+    }
+    (cell.x ? xs : pluses)[row] |= bit;
+    if (cell.latched) latched[row] |= bit;
+    if (cell.previous_value == Cell::Value_::ONE) ones[row] |= bit;
+    if (cell.previous_value == Cell::Value_::ZERO) zeros[row] |= bit;
+  }
+};
+
+
+// Direct-mapped memo of resolved cell values
+// Entries are keyed by the resolve-relevant signatures of all squares.
+struct ResolveCache {
+  size_t entries = 0; // power of 2, or 0 if disabled
+  std::vector<uint8_t> valid; // entry
+  std::vector<uint64_t> hashes; // entry
+  std::vector<uint16_t> signatures; // (entry, square)
+  std::vector<Cell::Value> values; // (entry, square)
+  size_t hits = 0;
+  size_t misses = 0;
+};
+
+
+// Instructions of a bot at a square, compiled for each direction the bot can come in moving
+struct ProgramStep {
+  Operation operation;
+  Direction moving[5]; // incoming direction -> direction after the direction instruction
+  uint8_t stops = 0; // bit d is set if moving in direction d from the square stops at the boundary
+  Direction next(Direction incoming) const { return moving[static_cast<int>(static_cast<Direction_>(incoming))]; }
+  bool stops_moving(Direction direction) const { return stops >> static_cast<int>(static_cast<Direction_>(direction)) & 1; }
+};
+
+
+// State of a board at a cycle saved for finding loops with Brent's algorithm
+// Every following cycle of the test case is compared with the checkpoint until the number of cycles
+// since it reaches a power of two, when the checkpoint moves to the current cycle and the power doubles.
+struct LoopCheckpoint {
+  bool valid = false;
+  size_t cycle = 0;
+  size_t power = 1;
+  uint64_t hash = 0;
+  size_t step = 0;
+  Grid<Cell> cells;
+  ReservedVector<Bot> bots;
+  ReservedVector<bool> powers; // output
+  std::vector<LaneValue> lane_values; // square
+  LoopCheckpoint(size_t m, size_t n) : cells(m, n, RANGE) {}
+};
+
+
+// default number of moves between full snapshots in the journal
+constexpr size_t DEFAULT_KEYFRAME_INTERVAL = 64;
+
+// Changes made by moves, recorded to step back through them
+// Each entry holds the runtime state before a move and the previous state of the cells the move
+// changed, saved as they are first changed, and every keyframe_interval entries a keyframe of the squares
+// changed since the first recorded move is kept, so any recorded cycle is reached by restoring the next
+// keyframe and undoing at most keyframe_interval moves.
+struct Journal {
+  struct Keyframe {
+    size_t entries = 0; // entries recorded before the keyframe
+    size_t cycle = 0;
+    size_t touched = 0; // squares changed before the keyframe
+    size_t begin = 0; // offset in frames
+  };
+  bool recording = false;
+  size_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+  std::vector<uint8_t> changes; // entries back to back
+  std::vector<size_t> entries; // end of each entry in changes
+  std::vector<Keyframe> keyframes;
+  std::vector<uint8_t> frames; // runtime state and cells of the touched squares of each keyframe back to back
+  // cells before the first recorded move, and the squares changed since in the order they were first changed
+  std::vector<Cell> base; // square
+  std::vector<Square> touched;
+  // move in which each square was last saved, or 0 if it is untouched
+  std::vector<uint32_t> saved; // square
+  uint32_t move = 0;
+  bool saving = false; // during a recorded move
+};
+
+
+enum class ResolveEngine {
+  SCC, // Tarjan's algorithm over the priority nodes of every cell
+  WORKLIST, // propagate values in topological order and use SCC only for cycles and what they affect
+  BITBOARD, // decide plain cells outside of cycles from bit planes of the rows and use SCC for the rest
+};
+
+// default number of cells to resolve before using multiple threads
+constexpr size_t PARALLEL_RESOLVE_MIN_CELLS = 1024;
+
+class Workspace; // resolve.h
+// Owning pointer to the scratch memory of a board
+// Copies of a board get their own scratch memory rather than sharing it.
+class WorkspacePtr {
+  Workspace *workspace = nullptr;
+public:
+  WorkspacePtr(size_t m, size_t n);
+  WorkspacePtr(const WorkspacePtr &oth);
+  WorkspacePtr(WorkspacePtr &&oth) : workspace(oth.workspace) { oth.workspace = nullptr; }
+  WorkspacePtr& operator=(WorkspacePtr &&oth);
+  ~WorkspacePtr();
+  Workspace& operator*() const { return *workspace; }
+  Workspace* operator->() const { return workspace; }
+};
+
+
 class Board {
   // setup
   const size_t m, n, nbots;
@@ -510,6 +842,10 @@ class Board {
   Grid<bool> trespassable;
   std::vector<Grid<Direction>> directions; // bot -> grid
   std::vector<Grid<Operation>> operations; // bot -> grid
+  // bot -> grid of the instructions compiled with the trespassable squares by reset_and_validate
+  std::vector<Grid<ProgramStep>> programs;
+  // squares on the paths of any bot, found from the programs when the board is reset to its first test case
+  Grid<bool> reachable;
   std::vector<Bot> bots;
   std::vector<Input> inputs;
   std::vector<Output> outputs;
@@ -519,6 +855,8 @@ class Board {
   // error
   Error error;
   // runtime
+  // Grids of the runtime state share a halo of RANGE empty squares, so their squares are interchangeable
+  // and the neighborhood of any square on the board is in the grid.
   Grid<Cell> cells;
   // indicator for whether I/O incremented on most recent cycle
   // does not count if moved to new test case
@@ -526,7 +864,88 @@ class Board {
   size_t test_case = 0;
   size_t step = 0; // step index for I/O
   size_t cycle = 0; // cycle count
+  // squares changed since the most recent resolve
+  Grid<bool> dirty;
+  ReservedVector<Square> changed;
+  // latched cells no bot can reach, which keep their values and are left out of resolution
+  Grid<bool> constant;
+  bool resolve_constants = true;
+  // interaction graph of the cells
+  Grid<Influences> influences;
+  // resolve-relevant state of each square and the Zobrist hash over all squares
+  Grid<uint16_t> signatures;
+  uint64_t signature_hash = 0;
+  // the same state as bit planes, for boards narrow enough
+  CellPlanes planes;
+  ResolveCache resolve_cache;
+  // only re-resolve the cells that can be influenced by dirty squares
+  bool incremental_resolve = true;
+  ResolveEngine resolve_engine = ResolveEngine::SCC;
+  // resolve clusters of at most two cells directly instead of with the solver
+  bool resolve_pairs = true;
+  // resolve independent clusters concurrently when there are enough cells to resolve
+  size_t resolve_threads = 1;
+  size_t parallel_resolve_min_cells = PARALLEL_RESOLVE_MIN_CELLS;
+  // lane simulation, where bit i of lanes is set while lane i runs test case lane_test_cases[i]
+  // The cells hold the values of the first lane.
+  bool simulating_lanes = false;
+  uint64_t lanes = 0;
+  std::vector<size_t> lane_test_cases; // lane
+  std::vector<LaneResult> lane_results; // lane
+  std::vector<LaneValue> lane_values; // square
+  std::vector<LaneValue> lane_previous_values; // square
+  // stop runs at the first repeated state of a test case
+  bool detect_loops = true;
+  LoopCheckpoint loop_checkpoint;
+  Journal journal;
   // resolve memory allocation
+  WorkspacePtr workspace;
+
+  // flag a square to be resolved again
+  void mark_dirty(Square square);
+  void mark_dirty(const Location &location) { mark_dirty(cells.square(location)); }
+  void mark_all_dirty();
+  // find the squares on the paths of the bots
+  void find_reachable();
+  // classify the constant cells from the reachable squares
+  void find_constants();
+  // reset the board to run test cases from first_test_case in lanes
+  bool start_lanes(size_t first_test_case, size_t nlanes);
+  // lanes that take the same branches as the first lane in the next move
+  uint64_t get_branching_lanes() const;
+  // set the values of the cells to those of the first lane
+  void sync_lanes();
+  // hash of the state that determines the following cycles of the test case, without lane values
+  uint64_t get_state_hash() const;
+  // compare the state with the loop checkpoint, moving it as needed, and return the running lanes
+  // (or 1 outside of lanes) that are in a loop
+  uint64_t find_loop();
+  // error for the loop found by find_loop
+  Error get_loop_error() const;
+  // take over the runtime state of another board with the same setup
+  void take_state(Board &board);
+  // step forward one cycle without recording it in the journal
+  bool simulate_move();
+  // save the cell of a square in the journal entry of the move being recorded before it first changes
+  void journal_cell(Square square);
+  void journal_cell(const Location &location) { journal_cell(cells.square(location)); }
+  // append the packed cells, or the runtime state other than the cells, to a blob
+  void pack_cells(std::vector<uint8_t> &blob) const;
+  void put_runtime(std::vector<uint8_t> &blob) const;
+  // read the runtime state written by put_runtime at offset and advance past it, setting it if apply
+  // Return true if it is invalid.
+  bool get_runtime(const std::vector<uint8_t> &blob, size_t &offset, bool apply);
+  // restore a snapshot without clearing the journal
+  bool restore_state(const std::vector<uint8_t> &blob);
+  void clear_journal();
+  // restore the cells of the most recent journal entry, or of a keyframe, and drop the later entries,
+  // adding the squares whose influences change to moved
+  void undo_entry(std::vector<Location> &moved);
+  void restore_keyframe(size_t k, std::vector<Location> &moved);
+  // recompute the influences on the square
+  void set_influences(const Location &location);
+  // recompute the influences of squares in range of a cell that moved or changed latch state
+  void update_influences(const Location &location);
 public:
   size_t get_m() const { return m; }
   size_t get_n() const { return n; }
@@ -544,6 +963,10 @@ public:
   size_t get_cycle() const { return cycle; }
   const Grid<Cell>& get_cells() const { return cells; }
   Color get_last_color() const { return last_color; }
+  bool get_incremental_resolve() const { return incremental_resolve; }
+  ResolveEngine get_resolve_engine() const { return resolve_engine; }
+  size_t get_resolve_cache_hits() const { return resolve_cache.hits; }
+  size_t get_resolve_cache_misses() const { return resolve_cache.misses; }
   int get_num_cells() const;
   int get_num_instructions() const;
   int get_num_symbols() const;
@@ -559,27 +982,82 @@ public:
   // set output color sequence
   bool set_output_colors(const std::vector<std::string> &colors);
   // set level grid
-  bool set_level(const std::string &grid_fixed);
+  bool set_level(std::string_view grid_fixed);
   // set initial cell layout
-  bool set_cells(const std::string &grid_cells);
+  bool set_cells(std::string_view grid_cells);
+  bool set_cells(const std::string &grid_cells) { return set_cells(std::string_view(grid_cells)); }
   // set instructions for bot k
-  bool set_instructions(size_t k, const std::string &grid_directions, const std::string &grid_operations);
+  bool set_directions(size_t k, std::string_view grid_directions);
+  bool set_operations(size_t k, std::string_view grid_operations);
+  bool set_instructions(size_t k, std::string_view grid_directions, std::string_view grid_operations);
+  bool set_instructions(size_t k, const std::string &grid_directions, const std::string &grid_operations) {
+    return set_instructions(k, std::string_view(grid_directions), std::string_view(grid_operations));
+  }
+  // fail the setup with an error found outside the board, such as while parsing its files
+  bool set_error(const Error &error);
+  // place the error of the setup at a 1-based position of the text it was read from, see Error::at
+  void set_error_position(size_t line, size_t column);
   // check and set level properties
   bool validate_level();
+  // compile the instructions of bot k into its program, stopping at the squares that were not trespassable
+  // at the last validation
+  void compile_program(size_t k);
+  // compile the instructions of each bot into its program
+  void compile_programs();
 
   // Runtime
-  // check if setup is valid
+  // check if setup is valid, and compile the instructions set since the last reset
   // ' ' for any, '.' for nothing, < v > ^ for equal to another, x+/\-| for cell
   bool reset_and_validate(bool reset_test_case);
   bool reset_and_validate() { return reset_and_validate(true); }
+  // toggle incremental resolution (the full board is resolved when off)
+  void set_incremental_resolve(bool incremental);
+  void set_resolve_engine(ResolveEngine engine) { resolve_engine = engine; }
+  void set_resolve_pairs(bool use_pairs) { resolve_pairs = use_pairs; }
+  // toggle ending runs with an error when the state repeats within a test case
+  void set_detect_loops(bool detect) { detect_loops = detect; }
+  // toggle leaving the constant cells out of resolution
+  void set_resolve_constants(bool use_constants);
+  // set the number of threads resolving independent clusters of at least min_cells cells in total
+  void set_resolve_threads(size_t threads, size_t min_cells = PARALLEL_RESOLVE_MIN_CELLS);
+  // set the number of memoized resolve results (0 to disable) and reset the counters
+  void set_resolve_cache_size(size_t entries);
   // resolve the board
   bool resolve();
   // step forward one cycle
   bool move();
   // run through verification and return true if finishes
+  // A state repeated within a test case ends the run early with an INFINITE_LOOP error.
   std::pair<bool, bool> run(size_t max_cycles, std::ostream *os);
   // default parameter as separate function for binding
   std::pair<bool, bool> run(size_t max_cycles) { return run(max_cycles, nullptr); }
+  // run like run with the remaining test cases simulated concurrently on copies of the board by up to
+  // threads threads, and leave the board as run would
+  // The cycles of the test cases add up and the first failure in test case order ends the run.
+  std::pair<bool, bool> run_parallel(size_t max_cycles, size_t threads);
+  // run each test case on its own like run for at most max_cycles, simulating up to LANES test cases
+  // per move in bit-sliced lanes, and return the result of each test case
+  // Lanes split into separate groups when their bots take different branches.
+  // Loops in a lane are detected at the same cycle as in run.
+  std::vector<LaneResult> run_lanes(size_t max_cycles) const;
+  // run_lanes on the test cases given by the input bits and output colors of each, as in set_input_bits
+  // and set_output_colors, instead of those of the level
+  std::vector<LaneResult> run_lanes(size_t max_cycles, const std::vector<std::vector<std::string>> &bits,
+      const std::vector<std::string> &colors) const;
+
+  // Snapshots
+  // save the runtime state of the board in a compact binary blob
+  std::vector<uint8_t> snapshot() const;
+  // restore the runtime state from a snapshot of a board with the same setup, and return true on error
+  // A rejected snapshot leaves the board unchanged.
+  // Loop detection starts over from the restored state, and the journal is cleared.
+  bool restore(const std::vector<uint8_t> &blob);
+  // toggle recording the changes of each move in a journal with a keyframe every keyframe_interval moves
+  void set_record_journal(bool record, size_t keyframe_interval);
+  // undo the most recent recorded move, and return true if there is none
+  bool step_back();
+  // go back to a recorded cycle, and return true without changing the board if it cannot be reached
+  bool seek(size_t target_cycle);
 
   // Output
   // get paths
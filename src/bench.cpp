@@ -0,0 +1,148 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sstream>
+
+#include "simulate.h"
+#include "level.h"
+#include "resolve.h"
+using namespace puzzle;
+
+constexpr int REPETITIONS = 20;
+constexpr int MAX_CYCLES = 999;
+constexpr size_t MAX_BOTS = 64;
+constexpr size_t SHUTTLE_LENGTH = 8;
+constexpr size_t LATTICE_SIZE = 63;
+constexpr int LATTICE_CYCLES = 20;
+
+std::string read(const char *filename) {
+  std::ifstream file(filename);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+// Level and submission where each bot has a row of its own to carry a cell back and forth on
+std::pair<std::string, std::string> shuttles(size_t nbots) {
+  const size_t m = 2 * nbots;
+  const std::string empty_row = std::string(SHUTTLE_LENGTH, '_') + "\n";
+  std::stringstream level, submission;
+  level << m << " " << SHUTTLE_LENGTH << " " << nbots << " 0 0 1" << std::endl;
+  for (size_t y=0; y<m; ++y) level << empty_row;
+  level << "B" << std::endl;
+  for (size_t y=0; y<m; ++y) submission << (y % 2 ? empty_row : "_x" + empty_row.substr(2));
+  for (size_t k=0; k<nbots; ++k) {
+    submission << std::endl;
+    for (size_t y=0; y<m; ++y) submission << (y == 2 * k ? ">>____<_\n" : empty_row);
+    submission << std::endl;
+    for (size_t y=0; y<m; ++y) submission << (y == 2 * k ? "Sg______\n" : empty_row);
+  }
+  return {level.str(), submission.str()};
+}
+
+// Print a line of timing results
+void print_timing(const std::string &name, size_t cycles, double seconds) {
+  std::cout << std::setw(40) << std::left << name << std::right
+    << std::setw(8) << cycles << " cycles "
+    << std::setw(10) << std::fixed << std::setprecision(4) << seconds << " s "
+    << std::setw(12) << std::setprecision(0) << cycles / seconds << " cycles/s" << std::endl;
+}
+
+// Run each example REPETITIONS times on boards set up by configure, and print the total,
+// after the results of each example if verbose
+void time_examples(int argc, char *argv[], const std::string &name, void (*configure)(Board&), bool verbose) {
+  size_t total_cycles = 0;
+  double total_seconds = 0;
+  for (int i=1; i<argc; i+=2) {
+    const std::string level = read(argv[i]);
+    const std::string submission = read(argv[i+1]);
+    size_t cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int k=0; k<REPETITIONS; ++k) {
+      Board board = load(level, submission);
+      configure(board);
+      board.run(MAX_CYCLES);
+      cycles += board.get_cycle();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total_cycles += cycles;
+    total_seconds += seconds;
+    if (verbose) print_timing(argv[i+1], cycles, seconds);
+  }
+  print_timing(name, total_cycles, total_seconds);
+}
+
+// Level and submission of a square board of latched cells with unlatched cells on every third row and column,
+// whose bot stays put, so every cell is resolved from latched cells
+std::pair<std::string, std::string> lattice(size_t size) {
+  std::stringstream level, submission;
+  level << size << " " << size << " 1 0 0 1" << std::endl;
+  for (size_t y=0; y<size; ++y) level << std::string(size, '_') << std::endl;
+  level << "B" << std::endl;
+  for (size_t y=0; y<size; ++y) {
+    for (size_t x=0; x<size; ++x) submission << (y % 3 == 0 && x % 3 == 0 ? 'x' : (x + y) % 2 ? '/' : '\\');
+    submission << std::endl;
+  }
+  submission << std::endl;
+  for (size_t y=0; y<size; ++y) submission << std::string(size, '_') << std::endl;
+  submission << std::endl;
+  for (size_t y=0; y<size; ++y) submission << (y ? std::string(size, '_') : "S" + std::string(size - 1, '_')) << std::endl;
+  return {level.str(), submission.str()};
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc % 2 == 0) {
+    std::cerr << "Args: level_file submission_file [level_file submission_file ...]" << std::endl;
+    return 1;
+  }
+  constexpr size_t node_size = Nodes::MAX_DEGREE * sizeof(Nodes::Index) + sizeof(uint8_t) + sizeof(Cell::Value) + sizeof(Nodes::State);
+  std::cout << "Resolve node size: " << node_size << " bytes (" << 2 * MAXR * node_size << " bytes per square)" << std::endl;
+  time_examples(argc, argv, "total", [](Board &board) {}, true);
+  // every cell resolved every cycle, which is bound by the traversal of the resolve nodes
+  time_examples(argc, argv, "total, full board", [](Board &board) {
+    board.set_incremental_resolve(false);
+    board.set_resolve_cache_size(0);
+    board.set_resolve_pairs(false);
+  }, false);
+  // plain cells decided in bulk, against the solver, on a board whose cells are all resolved every cycle
+  std::cout << std::endl;
+  const auto [lattice_level, lattice_submission] = lattice(LATTICE_SIZE);
+  for (const ResolveEngine engine : {ResolveEngine::SCC, ResolveEngine::BITBOARD}) {
+    size_t cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int k=0; k<REPETITIONS; ++k) {
+      Board board = load(lattice_level, lattice_submission);
+      board.set_detect_loops(false);
+      board.set_incremental_resolve(false);
+      board.set_resolve_constants(false);
+      board.set_resolve_cache_size(0);
+      board.set_resolve_engine(engine);
+      board.run(LATTICE_CYCLES);
+      cycles += board.get_cycle();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    print_timing(Formatter() << LATTICE_SIZE << "x" << LATTICE_SIZE << " lattice by " <<
+      (engine == ResolveEngine::BITBOARD ? "bitboard" : "solver"), cycles, seconds);
+  }
+  // scaling with the number of bots, which all move a cell every cycle
+  std::cout << std::endl;
+  for (size_t nbots=2; nbots<=MAX_BOTS; nbots*=2) {
+    const auto [level, submission] = shuttles(nbots);
+    size_t cycles = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int k=0; k<REPETITIONS; ++k) {
+      Board board = load(level, submission);
+      board.set_detect_loops(false);
+      board.run(MAX_CYCLES);
+      cycles += board.get_cycle();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::setw(40) << std::left << std::string(Formatter() << nbots << " shuttling bots") << std::right
+      << std::setw(8) << cycles << " cycles "
+      << std::setw(10) << std::fixed << std::setprecision(4) << seconds << " s "
+      << std::setw(12) << std::setprecision(0) << cycles / seconds << " cycles/s "
+      << std::setw(12) << cycles * nbots / seconds << " bot moves/s" << std::endl;
+  }
+}
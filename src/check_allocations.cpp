@@ -0,0 +1,59 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "check.h"
+#include "check_configurations.h"
+using namespace puzzle;
+
+// Check that running the example solutions does not allocate after the first cycle in any configuration
+
+// Heap allocations of the program, counted to check that running a board does not allocate
+std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+  ++allocations;
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  ++allocations;
+  const size_t align = static_cast<size_t>(alignment);
+  if (void *p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+// Count the heap allocations of running the board after its first cycle, including moving on to
+// the following test cases and the error that ends the run
+size_t count_allocations(Board board) {
+  if (board.resolve() || board.check_status() != Status::RUNNING || board.move()) return 0;
+  const size_t before = allocations;
+  board.run(MAX_CYCLES);
+  return allocations - before;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_allocations", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    int failures = 0;
+    for (const auto &configuration : CONFIGURATIONS) {
+      Board configured = board;
+      configuration.second(configured);
+      const size_t allocated = count_allocations(configured);
+      if (allocated) {
+        std::cout << example << ": " << configuration.first << " allocates " << allocated
+          << " times after the first cycle" << std::endl;
+        ++failures;
+      }
+    }
+    return failures;
+  });
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+
+#include "check.h"
+using namespace puzzle;
+
+// Check that stepping back and seeking through the journal of the example solutions gives the expected states
+
+// Step back through the journal of a run and seek to each recorded cycle, then step forward again
+// Return the first cycle where the state differs from the expected states, or -1
+int compare_journal(Board board, const Expected &expected) {
+  board.set_record_journal(true, 3);
+  for (size_t cycle=0; cycle<expected.states.size(); ++cycle) {
+    const bool error = cycle ? board.move() : board.resolve();
+    if (state_hash(board) != expected.states[cycle]) return cycle;
+    if (error || board.check_status() != Status::RUNNING) break;
+  }
+  const size_t last = board.get_cycle();
+  Board stepped = board;
+  for (size_t cycle=last; cycle>0; --cycle) {
+    if (stepped.step_back() || state_hash(stepped) != expected.states[cycle-1]) return cycle - 1;
+  }
+  if (!stepped.step_back()) return 0;
+  for (size_t cycle=last+1; cycle-->0;) {
+    Board seeking = board;
+    if (seeking.seek(cycle) || state_hash(seeking) != expected.states[cycle]) return cycle;
+    for (size_t next=cycle+1; next<=last; ++next) {
+      seeking.move();
+      if (state_hash(seeking) != expected.states[next]) return next;
+    }
+  }
+  // seeking before the start of a journal recorded partway through fails without changing the board
+  if (last > 1) {
+    Board seeking = board;
+    seeking.seek(1);
+    seeking.set_record_journal(true, 3);
+    seeking.move();
+    if (!seeking.seek(0) || state_hash(seeking) != expected.states[2]) return 0;
+  }
+  return -1;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_journal", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    Board unlooped = board;
+    unlooped.set_detect_loops(false);
+    const int cycle = compare_journal(unlooped, expected);
+    if (cycle < 0) return 0;
+    std::cout << example << ": journal differs at cycle " << cycle << std::endl;
+    return 1;
+  });
+}
@@ -0,0 +1,38 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+using namespace puzzle;
+
+// Check that running the test cases of the example solutions in lanes gives the expected outcome of each
+
+// Compare the lanes with the expected outcomes of running each test case on its own and return the number of mismatches
+int compare_lanes(const std::vector<LaneResult> &results, const std::vector<Outcome> &expected, const std::string &name) {
+  if (results.size() != expected.size()) {
+    std::cout << name << ": " << results.size() << " test cases in lanes instead of " << expected.size() << std::endl;
+    return 1;
+  }
+  int failures = 0;
+  for (size_t t=0; t<results.size(); ++t) {
+    // lanes do not tell apart the runs that end with an error
+    const Outcome result = {results[t].passed, expected[t].error, results[t].cycles, results[t].error.error_reason(),
+      std::string(results[t].error)};
+    if (result != expected[t]) {
+      std::cout << name << ": test case " << t << " in lanes " << result << " instead of " << expected[t] << std::endl;
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_lanes", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    Board unlooped = board;
+    unlooped.set_detect_loops(false);
+    return compare_lanes(unlooped.run_lanes(MAX_CYCLES), expected.test_cases, example + " lanes") +
+      compare_lanes(unlooped.run_lanes(MAX_CYCLES, expected.random_bits, expected.random_colors),
+        expected.random_test_cases, example + " random lanes");
+  });
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+using namespace puzzle;
+
+// Check that detecting infinite loops only ends the runs of the example solutions early
+// The expected outputs are without loop detection, so a run may instead fail with an infinite loop
+// detected no later than the expected run ended, if the expected run did not pass.
+
+bool matches(const Outcome &result, const Outcome &expected) {
+  return result == expected || (result.reason == ErrorReason::INFINITE_LOOP && !result.passed &&
+    !expected.passed && result.cycles <= expected.cycles);
+}
+
+int compare_outcomes(const std::vector<Outcome> &results, const std::vector<Outcome> &expected, const std::string &name) {
+  if (results.size() != expected.size()) {
+    std::cout << name << ": " << results.size() << " outcomes instead of " << expected.size() << std::endl;
+    return 1;
+  }
+  int failures = 0;
+  for (size_t i=0; i<results.size(); ++i) {
+    if (!matches(results[i], expected[i])) {
+      std::cout << name << " " << i << ": " << results[i] << " instead of " << expected[i] << std::endl;
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+// Outcomes of the test cases run in lanes, like the expected outcomes of each test case on its own
+std::vector<Outcome> lane_outcomes(const std::vector<LaneResult> &results, const std::vector<Outcome> &expected) {
+  std::vector<Outcome> outcomes;
+  for (size_t t=0; t<results.size(); ++t) {
+    // lanes do not tell apart the runs that end with an error
+    outcomes.push_back({results[t].passed, t < expected.size() && expected[t].error, results[t].cycles,
+      results[t].error.error_reason(), std::string(results[t].error)});
+  }
+  return outcomes;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_loops", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    if (expected.runs.size() != 2 * RUN_CYCLES.size()) {
+      std::cout << example << ": " << expected.runs.size() << " expected runs" << std::endl;
+      return 1;
+    }
+    std::vector<Outcome> runs, parallel_runs;
+    for (const Board &test_cases : {board, with_test_cases(board, expected.random_bits, expected.random_colors)}) {
+      for (const size_t max_cycles : RUN_CYCLES) {
+        Board run = test_cases;
+        runs.push_back(outcome(run, run.run(max_cycles)));
+        Board parallel = test_cases;
+        parallel_runs.push_back(outcome(parallel, parallel.run_parallel(max_cycles, 4)));
+      }
+    }
+    return compare_outcomes(runs, expected.runs, example + " runs") +
+      compare_outcomes(parallel_runs, expected.runs, example + " parallel runs") +
+      compare_outcomes(lane_outcomes(board.run_lanes(MAX_CYCLES), expected.test_cases), expected.test_cases,
+        example + " lanes") +
+      compare_outcomes(lane_outcomes(board.run_lanes(MAX_CYCLES, expected.random_bits, expected.random_colors),
+        expected.random_test_cases), expected.random_test_cases, example + " random lanes");
+  });
+}
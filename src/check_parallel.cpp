@@ -0,0 +1,38 @@
+#include <iostream>
+#include <string>
+
+#include "check.h"
+using namespace puzzle;
+
+// Check that running the test cases of the example solutions concurrently ends like the expected runs
+
+// Compare running the test cases concurrently with the expected runs for each of RUN_CYCLES,
+// starting at the given expected run, and return the number of mismatches
+int compare_parallel(const Board &board, const Expected &expected, size_t first_run, const std::string &name) {
+  int failures = 0;
+  for (size_t i=0; i<RUN_CYCLES.size(); ++i) {
+    Board parallel = board;
+    const Outcome result = outcome(parallel, parallel.run_parallel(RUN_CYCLES[i], 4));
+    if (result != expected.runs[first_run + i] || state_hash(parallel) != expected.run_states[first_run + i]) {
+      std::cout << name << ": running test cases in parallel for at most " << RUN_CYCLES[i] << " cycles "
+        << result << " instead of " << expected.runs[first_run + i] << std::endl;
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_parallel", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    if (expected.runs.size() != 2 * RUN_CYCLES.size()) {
+      std::cout << example << ": " << expected.runs.size() << " expected runs" << std::endl;
+      return 1;
+    }
+    Board unlooped = board;
+    unlooped.set_detect_loops(false);
+    return compare_parallel(unlooped, expected, 0, example + " parallel test cases") +
+      compare_parallel(with_test_cases(unlooped, expected.random_bits, expected.random_colors), expected,
+        RUN_CYCLES.size(), example + " random parallel test cases");
+  });
+}
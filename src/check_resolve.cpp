@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include "check.h"
+#include "check_configurations.h"
+using namespace puzzle;
+
+// Check that every configuration of the resolve steps through the example solutions with the expected states
+
+// Step the board like run and return the first cycle where it differs from the expected states, or -1
+int compare(Board board, const Expected &expected) {
+  for (size_t cycle=0; cycle<expected.states.size(); ++cycle) {
+    const bool error = cycle ? board.move() : board.resolve();
+    if (state_hash(board) != expected.states[cycle]) return cycle;
+    // the expected states end with the run or at MAX_CYCLES
+    const bool ended = error || board.check_status() != Status::RUNNING;
+    const bool last = cycle + 1 == expected.states.size();
+    if (ended ? !last : last && cycle < MAX_CYCLES) return cycle;
+  }
+  return -1;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_resolve", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    int failures = 0;
+    for (const auto &configuration : CONFIGURATIONS) {
+      Board configured = board;
+      configured.set_detect_loops(false);
+      configuration.second(configured);
+      const int cycle = compare(configured, expected);
+      if (cycle >= 0) {
+        std::cout << example << ": " << configuration.first << " differs at cycle " << cycle << std::endl;
+        ++failures;
+      }
+    }
+    return failures;
+  });
+}
@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+using namespace puzzle;
+
+// Check that a snapshot of every cycle of the example solutions restores the expected state
+
+// Restore a snapshot of every cycle into a fresh copy of the board and step both boards together
+// Return the first cycle where either differs from the expected states, or -1.
+int compare_restored(Board board, const Expected &expected) {
+  const Board fresh = board;
+  bool error = board.resolve();
+  for (size_t cycle=0; cycle<expected.states.size(); ++cycle) {
+    Board restored = fresh;
+    if (state_hash(board) != expected.states[cycle] || restored.restore(board.snapshot()) ||
+        state_hash(restored) != expected.states[cycle]) {
+      return cycle;
+    }
+    if (error || board.check_status() != Status::RUNNING || cycle + 1 == expected.states.size()) break;
+    error = board.move();
+    if (restored.move() != error || state_hash(restored) != state_hash(board)) return cycle + 1;
+  }
+  // a snapshot whose step (bytes 14-17) is past the outputs is rejected without changing the board
+  std::vector<uint8_t> blob = board.snapshot();
+  blob[17] = 0xff;
+  Board restored = board;
+  if (!restored.restore(blob) || state(restored) != state(board)) return board.get_cycle();
+  return -1;
+}
+
+int main(int argc, char *argv[]) {
+  return check_examples(argc, argv, "check_snapshot", [](const Board &board, const Expected &expected,
+      const std::string &example) {
+    Board unlooped = board;
+    unlooped.set_detect_loops(false);
+    const int cycle = compare_restored(unlooped, expected);
+    if (cycle < 0) return 0;
+    std::cout << example << ": restored snapshot differs at cycle " << cycle << std::endl;
+    return 1;
+  });
+}
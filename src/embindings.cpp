@@ -24,18 +24,34 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
     .property("test_case", &Board::get_test_case)
     .property("step", &Board::get_step)
     .property("cycle", &Board::get_cycle)
+    .property("resolve_cache_hits", &Board::get_resolve_cache_hits)
+    .property("resolve_cache_misses", &Board::get_resolve_cache_misses)
     .function("get_cells", &Board::get_cells)
     .function("get_paths", &Board::get_paths)
     .function("add_input", &Board::add_input)
     .function("add_output", &Board::add_output)
     .function("set_input_bits", &Board::set_input_bits)
     .function("set_output_colors", &Board::set_output_colors)
-    .function("set_cells", &Board::set_cells)
-    .function("set_instructions", &Board::set_instructions)
+    .function("set_cells", static_cast<bool(Board::*)(const std::string&)>(&Board::set_cells))
+    .function("set_instructions",
+      static_cast<bool(Board::*)(size_t, const std::string&, const std::string&)>(&Board::set_instructions))
+    .function("set_resolve_cache_size", &Board::set_resolve_cache_size)
+    .function("set_resolve_pairs", &Board::set_resolve_pairs)
+    .function("set_resolve_constants", &Board::set_resolve_constants)
+    .function("set_detect_loops", &Board::set_detect_loops)
+    .property("resolve_engine", &Board::get_resolve_engine, &Board::set_resolve_engine)
     .function("reset_and_validate", static_cast<bool(Board::*)(void)>(&Board::reset_and_validate))
     .function("resolve", &Board::resolve)
     .function("move", &Board::move)
     .function("run", static_cast<std::pair<bool,bool>(Board::*)(size_t)>(&Board::run))
+    .function("run_lanes", static_cast<std::vector<LaneResult>(Board::*)(size_t) const>(&Board::run_lanes))
+    .function("run_lanes", static_cast<std::vector<LaneResult>(Board::*)(size_t,
+      const std::vector<std::vector<std::string>>&, const std::vector<std::string>&) const>(&Board::run_lanes))
+    .function("snapshot", &Board::snapshot)
+    .function("restore", &Board::restore)
+    .function("set_record_journal", &Board::set_record_journal)
+    .function("step_back", &Board::step_back)
+    .function("seek", &Board::seek)
     .function("check_status", &Board::check_status)
     .function("get_error", &Board::get_error)
     .function("get_error_reason", &Board::get_error_reason)
@@ -87,6 +103,12 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
     .value("DONE", Status::DONE)
     ;
 
+  enum_<ResolveEngine>("ResolveEngine")
+    .value("SCC", ResolveEngine::SCC)
+    .value("WORKLIST", ResolveEngine::WORKLIST)
+    .value("BITBOARD", ResolveEngine::BITBOARD)
+    ;
+
   enum_<ErrorReason>("ErrorReason")
     .value("NONE", ErrorReason::NONE)
     .value("INVALID_LEVEL", ErrorReason::INVALID_LEVEL)
@@ -94,6 +116,7 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
     .value("RUNTIME_ERROR", ErrorReason::RUNTIME_ERROR)
     .value("WRONG_OUTPUT", ErrorReason::WRONG_OUTPUT)
     .value("TOO_MANY_CYCLES", ErrorReason::TOO_MANY_CYCLES)
+    .value("INFINITE_LOOP", ErrorReason::INFINITE_LOOP)
     ;
 
   value_object<Input>("Input")
@@ -108,18 +131,18 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
   class_<Cell>("Cell")
     .constructor<>()
     .constructor<char>()
-    .property("exists", &Cell::exists)
-    .property("x", &Cell::x)
-    .property("latched", &Cell::latched)
-    .property("offset", &Cell::offset)
-    .property("direction", +[](const Cell &cell){ return static_cast<char>(cell.direction); })
+    .property("exists", +[](const Cell &cell){ return static_cast<bool>(cell.exists); })
+    .property("x", +[](const Cell &cell){ return static_cast<bool>(cell.x); })
+    .property("latched", +[](const Cell &cell){ return static_cast<bool>(cell.latched); })
+    .property("offset", +[](const Cell &cell){ return static_cast<bool>(cell.offset); })
+    .property("direction", +[](const Cell &cell){ return static_cast<char>(Direction(cell.direction)); })
     .property("partner_delta", &Cell::partner_delta)
-    .property("value", +[](const Cell &cell){ return static_cast<char>(cell.value); })
-    .property("previous_value", +[](const Cell &cell){ return static_cast<char>(cell.previous_value); })
-    .property("moving", +[](const Cell &cell){ return static_cast<char>(cell.moving); })
-    .property("held", &Cell::held)
-    .property("rotating", &Cell::rotating)
-    .property("refreshing", &Cell::refreshing)
+    .property("value", +[](const Cell &cell){ return static_cast<char>(Cell::Value(cell.value)); })
+    .property("previous_value", +[](const Cell &cell){ return static_cast<char>(Cell::Value(cell.previous_value)); })
+    .property("moving", +[](const Cell &cell){ return static_cast<char>(Direction(cell.moving)); })
+    .property("held", +[](const Cell &cell){ return static_cast<bool>(cell.held); })
+    .property("rotating", +[](const Cell &cell){ return static_cast<bool>(cell.rotating); })
+    .property("refreshing", +[](const Cell &cell){ return static_cast<bool>(cell.refreshing); })
     .function("resolved", &Cell::resolved)
     .function("unresolved", &Cell::operator char)
     .property("color", +[](const Cell &cell){ return static_cast<char>(static_cast<Color>(cell)); })
@@ -138,6 +161,13 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
     .property("as_char", &Operation::operator char)
     ;
 
+  class_<LaneResult>("LaneResult")
+    .property("passed", &LaneResult::passed)
+    .property("cycles", &LaneResult::cycles)
+    .property("error", +[](const LaneResult &result){ return std::string(result.error); })
+    .property("error_reason", +[](const LaneResult &result){ return result.error.error_reason(); })
+    ;
+
   value_array<std::pair<bool, bool>>("PairValidErr")
     .element(&std::pair<bool, bool>::first)
     .element(&std::pair<bool, bool>::second)
@@ -168,4 +198,7 @@ EMSCRIPTEN_BINDINGS(puzzle_bindings) {
   register_vector<Color>("vector<Color>");
   register_vector<std::vector<Color>>("vector<vector<Color>>");
   register_vector<Grid<uint8_t>>("vector<Grid<uint8_t>>");
+  register_vector<LaneResult>("vector<LaneResult>");
+  register_vector<std::string>("vector<string>");
+  register_vector<std::vector<std::string>>("vector<vector<string>>");
 }
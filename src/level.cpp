@@ -1,7 +1,10 @@
 #include "level.h"
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <sstream>
 
@@ -9,6 +12,69 @@
 
 namespace puzzle {
 
+void Parser::advance(size_t count) {
+  for (const size_t end = pos + count; pos < end; ++pos) {
+    if (text[pos] == '\n') {
+      ++line;
+      line_start = pos + 1;
+    }
+  }
+}
+
+void Parser::skip_space() {
+  size_t end = pos;
+  while (end < text.size() && std::isspace(static_cast<unsigned char>(text[end]))) ++end;
+  advance(end - pos);
+}
+
+void Parser::start_value() {
+  value_line = line;
+  value_column = get_column();
+}
+
+bool Parser::integer(int &value) {
+  skip_space();
+  start_value();
+  if (pos >= text.size() || !std::isdigit(static_cast<unsigned char>(text[pos]))) return true;
+  const char *first = text.data() + pos;
+  const auto [last, ec] = std::from_chars(first, text.data() + text.size(), value);
+  if (ec != std::errc()) return true;
+  pos += last - first;
+  return false;
+}
+
+bool Parser::token(std::string_view &value) {
+  skip_space();
+  start_value();
+  size_t end = pos;
+  while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))) ++end;
+  if (end == pos) return true;
+  value = text.substr(pos, end - pos);
+  pos = end;
+  return false;
+}
+
+void Parser::skip_line() {
+  advance(std::min(text.find('\n', pos), text.size() - 1) + 1 - pos);
+}
+
+bool Parser::grid(size_t m, size_t n, std::string_view &value) {
+  // ignore leading blank lines
+  while (pos < text.size() && text[pos] == '\n') advance(1);
+  start_value();
+  const size_t start = pos;
+  for (size_t y=0; y<m; ++y) {
+    const size_t end = std::min(text.find('\n', pos), text.size());
+    if (end - pos != n) {
+      pos += std::min(end - pos, n);
+      return true;
+    }
+    advance(std::min(end + 1, text.size()) - pos);
+  }
+  value = text.substr(start, pos - start);
+  return false;
+}
+
 std::string get_grid(std::istream &is, int m) {
   std::stringstream ss;
   std::string line;
@@ -28,6 +94,12 @@ bool show(std::ostream *os, const std::string &line) {
   return true;
 }
 
+// Place the error the board failed with in the text of the value it failed on, and show it
+static void show_at(std::ostream *os, Board &board, size_t line, size_t column) {
+  board.set_error_position(line, column);
+  show(os, board.get_error());
+}
+
 bool verify(std::istream &is_level, std::istream &is_submission, std::ostream *os, bool print_board) {
   Board board = load(is_level, is_submission, os);
   if (board.check_status() == Status::INVALID) return false;
@@ -45,51 +117,71 @@ bool verify(std::istream &is_level, std::istream &is_submission, std::ostream *o
   return passes;
 }
 
-Board load(std::istream &is_level, std::istream &is_submission, std::ostream *os) {
-  std::string line;
+Board load(std::string_view level_text, std::string_view submission_text, std::ostream *os) {
   // Level
+  Parser level(level_text);
   int m, n, b, ni, no, nt;
-  is_level >> m >> n >> b >> ni >> no >> nt;
-  std::getline(is_level, line);
-  std::string level = get_grid(is_level, m);
-  Board board(m, n, b);
-  int y, x;
-  for (int k=0; k<ni; ++k) {
-    is_level >> y >> x;
-    if (board.add_input(y, x)) {
+  for (int *value : {&m, &n, &b, &ni, &no, &nt}) {
+    if (level.integer(*value)) {
+      Board board(0, 0, 0);
+      board.set_error(Error::InvalidLevelFormat.at(level.get_line(), level.get_column()));
       show(os, board.get_error());
       return board;
     }
   }
-  for (int k=0; k<no; ++k) {
-    is_level >> y >> x;
-    if (board.add_output(y, x)) {
+  level.skip_line();
+  Board board(m, n, b);
+  std::string_view grid;
+  if (level.grid(m, n, grid)) {
+    board.set_error(Error::BoardSizeMismatch.at(level.get_line(), level.get_column()));
+    show(os, board.get_error());
+    return board;
+  }
+  const size_t grid_line = level.get_value_line(), grid_column = level.get_value_column();
+  int y, x;
+  for (int k=0; k<ni+no; ++k) {
+    const bool invalid = level.integer(y);
+    const size_t line = level.get_value_line(), column = level.get_value_column();
+    if (invalid || level.integer(x)) {
+      board.set_error(Error::InvalidLevelFormat.at(level.get_line(), level.get_column()));
       show(os, board.get_error());
       return board;
     }
+    if (k < ni ? board.add_input(y, x) : board.add_output(y, x)) {
+      show_at(os, board, line, column);
+      return board;
+    }
   }
-  if (board.set_level(level)) {
-    show(os, board.get_error());
+  if (board.set_level(grid)) {
+    show_at(os, board, grid_line, grid_column);
     return board;
   }
   // I/O
-  std::vector<std::vector<std::string>> input_bits(nt);
+  std::vector<std::vector<std::string>> input_bits(nt, std::vector<std::string>(ni));
   std::vector<std::string> output_colors(nt);
+  std::string_view token;
+  // the tokens are checked together, so their errors are at the first token of the test cases
+  size_t io_line = level.get_line(), io_column = level.get_column();
   for (int t=0; t<nt; ++t) {
-    input_bits[t].resize(ni);
-    for (int k=0; k<ni; ++k) {
-      is_level >> line;
-      input_bits[t][k] = line;
+    for (int k=0; k<=ni; ++k) {
+      if (level.token(token)) {
+        board.set_error(Error::InvalidLevelFormat.at(level.get_line(), level.get_column()));
+        show(os, board.get_error());
+        return board;
+      }
+      if (!t && !k) {
+        io_line = level.get_value_line();
+        io_column = level.get_value_column();
+      }
+      (k < ni ? input_bits[t][k] : output_colors[t]) = token;
     }
-    is_level >> line;
-    output_colors[t] = line;
   }
   if (board.set_input_bits(input_bits)) {
-      show(os, board.get_error());
-      return board;
+    show_at(os, board, io_line, io_column);
+    return board;
   }
   if (board.set_output_colors(output_colors)) {
-    show(os, board.get_error());
+    show_at(os, board, io_line, io_column);
     return board;
   }
   // Validate level
@@ -98,18 +190,36 @@ Board load(std::istream &is_level, std::istream &is_submission, std::ostream *os
     return board;
   }
   // Submission
-  std::string cells = get_grid(is_submission, m);
-  if (board.set_cells(cells)) {
+  Parser submission(submission_text);
+  if (submission.grid(m, n, grid)) {
+    board.set_error(Error::BoardSizeMismatch.at(submission.get_line(), submission.get_column()));
     show(os, board.get_error());
     return board;
   }
+  if (board.set_cells(grid)) {
+    show_at(os, board, submission.get_value_line(), submission.get_value_column());
+    return board;
+  }
   for (int k=0; k<b; ++k) {
-    std::string directions = get_grid(is_submission, m);
-    std::string operations = get_grid(is_submission, m);
-    if (board.set_instructions(k, directions, operations)) {
+    std::string_view directions, operations;
+    if (submission.grid(m, n, directions)) {
+      board.set_error(Error::BoardSizeMismatch.at(submission.get_line(), submission.get_column()));
+      show(os, board.get_error());
+      return board;
+    }
+    if (board.set_directions(k, directions)) {
+      show_at(os, board, submission.get_value_line(), submission.get_value_column());
+      return board;
+    }
+    if (submission.grid(m, n, operations)) {
+      board.set_error(Error::BoardSizeMismatch.at(submission.get_line(), submission.get_column()));
       show(os, board.get_error());
       return board;
     }
+    if (board.set_operations(k, operations)) {
+      show_at(os, board, submission.get_value_line(), submission.get_value_column());
+      return board;
+    }
   }
   // Validate submission
   if (board.reset_and_validate()) {
@@ -119,10 +229,14 @@ Board load(std::istream &is_level, std::istream &is_submission, std::ostream *os
   return board;
 }
 
+Board load(std::istream &is_level, std::istream &is_submission, std::ostream *os) {
+  const std::string level{std::istreambuf_iterator<char>(is_level), std::istreambuf_iterator<char>()};
+  const std::string submission{std::istreambuf_iterator<char>(is_submission), std::istreambuf_iterator<char>()};
+  return load(std::string_view(level), std::string_view(submission), os);
+}
+
 Board load(const std::string &level, const std::string &submission) {
-  std::stringstream is_level(level);
-  std::stringstream is_submission(submission);
-  return load(is_level, is_submission, nullptr);
+  return load(std::string_view(level), std::string_view(submission), nullptr);
 }
 
 } // namespace puzzle
@@ -17,10 +17,27 @@ BOOST_PYTHON_MODULE(python_bindings)
     .add_property("test_case", &Board::get_test_case)
     .add_property("step", &Board::get_step)
     .add_property("cycle", &Board::get_cycle)
+    .add_property("resolve_cache_hits", &Board::get_resolve_cache_hits)
+    .add_property("resolve_cache_misses", &Board::get_resolve_cache_misses)
+    .def("set_resolve_cache_size", &Board::set_resolve_cache_size)
+    .def("set_resolve_threads", &Board::set_resolve_threads)
+    .def("set_resolve_pairs", &Board::set_resolve_pairs)
+    .def("set_resolve_constants", &Board::set_resolve_constants)
+    .def("set_detect_loops", &Board::set_detect_loops)
+    .add_property("resolve_engine", &Board::get_resolve_engine, &Board::set_resolve_engine)
     .def("reset_and_validate", static_cast<bool(Board::*)(void)>(&Board::reset_and_validate))
     .def("resolve", &Board::resolve)
     .def("move", &Board::move)
     .def("run", static_cast<std::pair<bool,bool>(Board::*)(size_t)>(&Board::run))
+    .def("run_parallel", &Board::run_parallel)
+    .def("run_lanes", static_cast<std::vector<LaneResult>(Board::*)(size_t) const>(&Board::run_lanes))
+    .def("run_lanes", static_cast<std::vector<LaneResult>(Board::*)(size_t,
+      const std::vector<std::vector<std::string>>&, const std::vector<std::string>&) const>(&Board::run_lanes))
+    .def("snapshot", &Board::snapshot)
+    .def("restore", &Board::restore)
+    .def("set_record_journal", &Board::set_record_journal)
+    .def("step_back", &Board::step_back)
+    .def("seek", &Board::seek)
     .def("check_status", &Board::check_status)
     .def("get_error", &Board::get_error)
     .def("get_error_reason", &Board::get_error_reason)
@@ -59,12 +76,51 @@ BOOST_PYTHON_MODULE(python_bindings)
     .value("DONE", Status::DONE)
     ;
 
+  enum_<ResolveEngine>("ResolveEngine")
+    .value("SCC", ResolveEngine::SCC)
+    .value("WORKLIST", ResolveEngine::WORKLIST)
+    .value("BITBOARD", ResolveEngine::BITBOARD)
+    ;
+
+  enum_<ErrorReason>("ErrorReason")
+    .value("NONE", ErrorReason::NONE)
+    .value("INVALID_LEVEL", ErrorReason::INVALID_LEVEL)
+    .value("INVALID_INPUT", ErrorReason::INVALID_INPUT)
+    .value("RUNTIME_ERROR", ErrorReason::RUNTIME_ERROR)
+    .value("WRONG_OUTPUT", ErrorReason::WRONG_OUTPUT)
+    .value("TOO_MANY_CYCLES", ErrorReason::TOO_MANY_CYCLES)
+    .value("INFINITE_LOOP", ErrorReason::INFINITE_LOOP)
+    ;
+
   class_<std::pair<bool, bool>>("PairValidErr")
     .def_readwrite("valid", &std::pair<bool, bool>::first)
     .def_readwrite("err", &std::pair<bool, bool>::second)
     ;
 
+  class_<LaneResult>("LaneResult")
+    .def_readonly("passed", &LaneResult::passed)
+    .def_readonly("cycles", &LaneResult::cycles)
+    .add_property("error", +[](const LaneResult &result) { return std::string(result.error); })
+    .add_property("error_reason", +[](const LaneResult &result) { return result.error.error_reason(); })
+    ;
+
   class_<std::vector<Bot>>("vector<Bot>")
     .def(vector_indexing_suite<std::vector<Bot>>())
     ;
+
+  class_<std::vector<LaneResult>>("vector<LaneResult>")
+    .def(vector_indexing_suite<std::vector<LaneResult>>())
+    ;
+
+  class_<std::vector<uint8_t>>("vector<uint8_t>")
+    .def(vector_indexing_suite<std::vector<uint8_t>>())
+    ;
+
+  class_<std::vector<std::string>>("vector<string>")
+    .def(vector_indexing_suite<std::vector<std::string>>())
+    ;
+
+  class_<std::vector<std::vector<std::string>>>("vector<vector<string>>")
+    .def(vector_indexing_suite<std::vector<std::vector<std::string>>>())
+    ;
 }
@@ -3,298 +3,837 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <functional>
 #include <iostream>
-#include <stack>
 #include <string>
 #include <vector>
 
 namespace puzzle {
 
-template<typename T>
-std::ostream& operator<<(std::ostream &os, const std::deque<T*> &st) {
-  os << "[";
-  for (auto x : st) os << *x << " ";
-  return os << "]";
-}
-
-enum R_ {
-  // r^2 distances where cell side length is 2
-  R0, // same offset cell
-  R4, // adjacent cells
-  R5, // 1x1 next to offset cell
-  R8, // kitty corner
-  R9, // 1x1 next to offset cell lengthwise
-  R10, // adjacent offset cells in opposite directions
-  R13, // 1x1 kitty corner to offset cell
-  R16, // distance 2
-  R17, // distance 2 sideways from offset cell
-  R20, // distance (2, 1)
-  MAXR, // number of elements of R
-};
-class R {
-  R_ r;
-public:
-  constexpr R() : r(R_::R0) {}
-  constexpr R(R_ r) : r(r) {}
-  constexpr R(size_t r) : r(static_cast<R_>(r)) {}
-  operator R_() const { return r; }
-  int v() const {
-    switch (*this) {
-    case R0: return 0;
-    case R4: return 4;
-    case R5: return 5;
-    case R8: return 8;
-    case R9: return 9;
-    case R10: return 10;
-    case R13: return 13;
-    case R16: return 16;
-    case R17: return 17;
-    case R20: return 20;
-    case MAXR: default: return -1;
-    }
-  }
-  static constexpr R FromInt(uint8_t d) {
-    switch (d) {
-    case 0: return R0;
-    case 4: return R4;
-    case 5: return R5;
-    case 8: return R8;
-    case 9: return R9;
-    case 10: return R10;
-    case 13: return R13;
-    case 16: return R16;
-    case 17: return R17;
-    case 20: return R20;
-    default: return MAXR;
+// Compute the effect of the cell at location + delta on the cell at location.
+// Return true if the neighbor is a source for the cell, setting its priority
+// and whether the cells are anticorrelated.
+static bool influence(const Grid<Cell> &cells, const Location &location, const Location &delta, R *r, bool *anti) {
+  const Cell &cell = cells.at(location);
+  const Cell &neighbor = cells.at(location + delta);
+  if (!cell || !neighbor) return false;
+  // calculate R distance (double coordinates and account for offset)
+  Location dist_delta(2 * delta.y, 2 * delta.x);
+  if (cell.offset) dist_delta = dist_delta + Location(cell.direction);
+  if (neighbor.offset) dist_delta = dist_delta - Location(neighbor.direction);
+  const uint8_t dist = sqr(dist_delta.y) + sqr(dist_delta.x);
+  // opposite orientation in same alignment have no effect
+  if (cell.x != neighbor.x && cell.offset == neighbor.offset) return false;
+  // opposite orientation in the same axis have not effect
+  if (cell.x != neighbor.x && (dist_delta.y == 0 || dist_delta.x == 0)) return false;
+  *r = R::FromInt(dist);
+  // distance beyond simulated range of effect
+  if (*r == MAXR) return false;
+  // compute whether cells are correlated or anticorrelated
+  if (cell.x == neighbor.x) *anti = cell.x ^ (dist_delta.y == 0 || dist_delta.x == 0);
+  else *anti = (dist_delta.y > dist_delta.x) ^ (-dist_delta.y > dist_delta.x) ^ (dist_delta.y * dist_delta.x < 0);
+  if (cell.is_diode() && cell.partner_delta() * dist_delta > 1) {
+    // cell.s a diode and neighbor is closer to diode partner
+    if (cell.partner_delta() != delta) return false;
+    // partner is the sink not the source
+    if (!cell.latched) return false;
+  }
+  if (neighbor.is_diode() && neighbor.partner_delta() * dist_delta < -1) {
+    // neighbor is a diode and cell.s closer to diode partner
+    if (cell.partner_delta() != delta) return false;
+  }
+  // only latched diodes cells can be affected
+  if (cell.latched && !(cell.is_diode() && cell.partner_delta() == delta)) return false;
+  return true;
+}
+
+Workspace::Workspace(size_t m, size_t n) :
+    m(m), n(n),
+    in_region(m, n, RANGE),
+    nodes(in_region.squares()),
+    bitboard(m),
+    claims(m, n) {
+  region.reserve(m * n);
+  clusters.reserve(m * n);
+  pending_lanes.reserve(m * n);
+  lane_clusters.reserve(m * n);
+  add_stacks(1);
+  moving.reserve(m * n);
+  claims.reset(0);
+  for (int dy=-RANGE; dy<=RANGE; ++dy) {
+    for (int dx=-RANGE; dx<=RANGE; ++dx) {
+      offsets[(dy + RANGE) * Influences::WIDTH + (dx + RANGE)] = dy * static_cast<int>(in_region.stride()) + dx;
     }
   }
-};
+}
+
+void Workspace::add_stacks(size_t nworkers) {
+  const size_t max_nodes = 2 * m * n * MAXR;
+  while (stacks.size() < nworkers) {
+    stacks.emplace_back();
+    stacks.back().callstack.reserve(max_nodes);
+    stacks.back().scc.reserve(max_nodes);
+    stacks.back().scc_initial.reserve(max_nodes);
+    stacks.back().cell_state.resize(in_region.squares());
+    stacks.back().cell_callstack.reserve(m * n);
+    stacks.back().cell_scc.reserve(m * n);
+    stacks.back().queue.reserve(m * n);
+  }
+}
+
+WorkerPool::WorkerPool(size_t nworkers) {
+  for (size_t worker=1; worker<nworkers; ++worker) {
+    threads.emplace_back(&WorkerPool::work, this, worker);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads) thread.join();
+}
+
+void WorkerPool::run(size_t njobs, const Job &job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->job = &job;
+    this->njobs = njobs;
+    next_job = 0;
+    active = threads.size();
+    ++generation;
+  }
+  wake.notify_all();
+  take_jobs(0);
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this]() { return active == 0; });
+  this->job = nullptr;
+}
+
+void WorkerPool::take_jobs(size_t worker) {
+  for (size_t i=next_job++; i<njobs; i=next_job++) (*job)(worker, i);
+}
+
+void WorkerPool::work(size_t worker) {
+  size_t seen_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [&]() { return stop || generation != seen_generation; });
+    if (stop) return;
+    seen_generation = generation;
+    lock.unlock();
+    take_jobs(worker);
+    lock.lock();
+    if (--active == 0) done.notify_one();
+  }
+}
+
+WorkspacePtr::WorkspacePtr(size_t m, size_t n) : workspace(new Workspace(m, n)) {}
 
-constexpr int RANGE = 2; // max range of 2 cells in each dimension
-
-class Node {
-public:
-  // Helper class for cell resolution
-  // Identity
-  Location location;
-  bool anti;
-  R r;
-
-  // Node properties
-  // link to node for opposite value
-  Node *antinode;
-  Cell *cell;
-  Cell::Value value;
-  // Edges
-  // needs to be max size for single distance plus 1
-  static constexpr int MAX_DEGREE = 9;
-  std::array<Node*, MAX_DEGREE> sources;
-  size_t nsources;
-  size_t source_index;
-  Node *higher; // pointer to decrease in R (higher priority)
-  Node *lower; // pointer to increase in R (lower priority)
-  bool use_lower;
-
-  // strongly connected component
-  int index;
-  int lowlink;
-  bool on_stack;
-  bool in_subcall;
-
-  friend std::ostream& operator<<(std::ostream &os, const Node &node) {
-    return os << (node.anti ? '-' : '+') << node.r.v() << node.location << node.value;
+WorkspacePtr::WorkspacePtr(const WorkspacePtr &oth) :
+    workspace(oth.workspace ? new Workspace(oth->m, oth->n) : nullptr) {}
+
+WorkspacePtr& WorkspacePtr::operator=(WorkspacePtr &&oth) {
+  delete workspace;
+  workspace = oth.workspace;
+  oth.workspace = nullptr;
+  return *this;
+}
+
+WorkspacePtr::~WorkspacePtr() {
+  delete workspace;
+}
+
+void Board::set_influences(const Location &location) {
+  Influences &square = influences.at(location);
+  square = Influences();
+  // constant cells have no sources and only take part in resolution through fixed sources
+  if (!cells.at(location) || constant.at(location)) return;
+  for (int dy=-RANGE; dy<=RANGE; ++dy) {
+    for (int dx=-RANGE; dx<=RANGE; ++dx) {
+      if (dy == 0 && dx == 0) continue;
+      // the halo holds the neighbors off the board, which are empty
+      const Location delta(dy, dx);
+      R r;
+      bool anti;
+      bool linked = false;
+      if (influence(cells, location, delta, &r, &anti)) {
+        square.sources[square.nsources++] = {static_cast<int8_t>(dy), static_cast<int8_t>(dx), static_cast<uint8_t>(r), anti};
+        square.sourced |= Influences::bit(dy, dx);
+        if (constant.at(location + delta)) square.fixed |= Influences::bit(dy, dx);
+        else linked = true;
+      }
+      if (linked || (!constant.at(location + delta) && influence(cells, location + delta, -delta, &r, &anti))) {
+        square.linked |= Influences::bit(dy, dx);
+      }
+    }
+  }
+}
+
+void Board::update_influences(const Location &location) {
+  // squares in the halo are empty and keep no influences
+  for (int dy=-RANGE; dy<=RANGE; ++dy) {
+    for (int dx=-RANGE; dx<=RANGE; ++dx) {
+      set_influences(location + Location(dy, dx));
+    }
+  }
+}
+
+// Square of a source of the cell in a square, which is always on the board
+static Square source_square(Square square, const Influences::Source &source, size_t stride) {
+  return square + source.dy * static_cast<int>(stride) + source.dx;
+}
+
+// Node for the value of a source of the cell in a square at a priority level
+static Nodes::Index source_node(const Nodes &nodes, const Influences &influence, const Grid<Cell> &cells,
+    Square square, const Influences::Source &source, size_t r) {
+  const Square neighbor = source_square(square, source, cells.stride());
+  if (influence.fixed & Influences::bit(source.dy, source.dx)) return nodes.constant(cells.at(neighbor).value);
+  return Nodes::index(neighbor, r, false);
+}
+
+// Construct the node and antinode of a square at the priority level of the node
+// along with any missing higher priority levels, so that higher nodes always exist.
+static void materialize(Nodes &nodes, const Grid<Influences> &influences, const Grid<Cell> &cells, Nodes::Index node) {
+  const Square square = Nodes::square(node);
+  const Influences &influence = influences.at(square);
+  size_t r = Nodes::r(node);
+  while (r > 0 && !nodes.materialized(Nodes::index(square, r - 1, false))) --r;
+  for (; r<=Nodes::r(node); ++r) {
+    const Nodes::Index level_node = Nodes::index(square, r, false);
+    const Nodes::Index level_antinode = Nodes::antinode(level_node);
+    nodes.stamp[level_node >> 1] = nodes.epoch;
+    for (const Nodes::Index init : {level_node, level_antinode}) {
+      nodes.nsources[init] = 0;
+      if (r > 0) nodes.sources_of(init)[nodes.nsources[init]++] = Nodes::higher(init);
+      nodes.value[init] = Cell::Value_::UNKNOWN;
+      nodes.state[init] = Nodes::State();
+    }
+    // add edges
+    for (size_t i=0; i<influence.nsources; ++i) {
+      const Influences::Source &source = influence.sources[i];
+      if (source.r != r) continue;
+      const Nodes::Index neighbor_node = source_node(nodes, influence, cells, square, source, r);
+      const Nodes::Index neighbor_antinode = Nodes::antinode(neighbor_node);
+      nodes.sources_of(level_node)[nodes.nsources[level_node]++] = source.anti ? neighbor_antinode : neighbor_node;
+      nodes.sources_of(level_antinode)[nodes.nsources[level_antinode]++] = source.anti ? neighbor_node : neighbor_antinode;
+    }
+  }
+}
+
+// Set the value of a square at R0 as already resolved
+static void complete(Nodes &nodes, size_t square, Cell::Value value) {
+  const Nodes::Index node = Nodes::index(square, 0, false);
+  nodes.stamp[node >> 1] = nodes.epoch;
+  for (const Nodes::Index completed : {node, Nodes::antinode(node)}) {
+    nodes.nsources[completed] = 0;
+    nodes.value[completed] = completed == node ? value : -value;
+    nodes.state[completed] = Nodes::State();
+    nodes.state[completed].index = 1;
+  }
+}
+
+// Value of a cell following a source cell of the given value
+static Cell::Value follow(Cell::Value value, bool anti) {
+  return anti ? -value : value;
+}
+
+// Value of a cell decided by its previous value, where an unknown value stays undefined
+static Cell::Value settle(Cell::Value value) {
+  return value ? value : Cell::Value(Cell::Value_::UNDEFINED);
+}
+
+// Resolve a cluster of one or two cells directly, with the same values as the solver
+// A single cell has no sources and keeps its previous value. In a pair, each cell can only have the other
+// cell as its source.
+// Return whether the cluster was small enough and had no constant sources.
+static bool resolve_pair(Nodes &nodes, const Grid<Influences> &influences, const Grid<Cell> &cells,
+    const Square *begin, const Square *end) {
+  if (end - begin > 2) return false;
+  for (const Square *square=begin; square!=end; ++square) {
+    if (influences.at(*square).fixed) return false;
+  }
+  if (end - begin == 1) {
+    complete(nodes, *begin, settle(cells.at(*begin).previous_value));
+    return true;
+  }
+  const Square a = begin[0];
+  const Square b = begin[1];
+  const Influences &influences_a = influences.at(a);
+  const Influences &influences_b = influences.at(b);
+  const Cell::Value previous_a = cells.at(a).previous_value;
+  const Cell::Value previous_b = cells.at(b).previous_value;
+  Cell::Value value_a, value_b;
+  if (!influences_a.nsources || !influences_b.nsources) {
+    // a cell without a source keeps its previous value, and the other one follows it
+    value_a = settle(previous_a);
+    value_b = settle(previous_b);
+    if (influences_a.nsources) value_a = follow(value_b, influences_a.sources[0].anti);
+    if (influences_b.nsources) value_b = follow(value_a, influences_b.sources[0].anti);
+  } else {
+    const Influences::Source &source_a = influences_a.sources[0];
+    const Influences::Source &source_b = influences_b.sources[0];
+    if (source_a.anti == source_b.anti) {
+      // the cells hold each other, so they agree on their previous values
+      value_a = settle(previous_a + follow(previous_b, source_a.anti));
+      value_b = follow(value_a, source_a.anti);
+    } else if (std::abs(source_a.r - source_b.r) <= 1) {
+      // the cells contradict each other within one priority
+      value_a = value_b = Cell::Value_::UNDEFINED;
+    } else {
+      // the cells contradict each other, and end up sharing the value left by the lower priority edge
+      value_a = value_b = settle(follow(previous_a, source_a.r > source_b.r) + follow(previous_b, source_b.anti));
+    }
+  }
+  complete(nodes, a, value_a);
+  complete(nodes, b, value_b);
+  return true;
+}
+
+// Words of the bit planes processed together, several rows per vector where the compiler supports it
+// Vectors are AVX2 registers of four rows or SSE registers of two, and single rows otherwise.
+#if defined(__GNUC__) && defined(__AVX2__)
+constexpr size_t WORD_ROWS = 4;
+typedef uint64_t PlaneWord __attribute__((vector_size(WORD_ROWS * sizeof(uint64_t))));
+#elif defined(__GNUC__)
+constexpr size_t WORD_ROWS = 2;
+typedef uint64_t PlaneWord __attribute__((vector_size(WORD_ROWS * sizeof(uint64_t))));
+#else
+typedef uint64_t PlaneWord;
+constexpr size_t WORD_ROWS = 1;
+#endif
+static_assert(WORD_ROWS <= CellPlanes::ROWS, "planes are padded for whole words");
+
+template<typename Word>
+static Word load(const std::vector<uint64_t> &plane, size_t row) {
+  Word word;
+  std::memcpy(&word, &plane[row], sizeof(Word));
+  return word;
+}
+
+template<typename Word>
+static void store(std::vector<uint64_t> &plane, size_t row, Word word) {
+  std::memcpy(&plane[row], &word, sizeof(Word));
+}
+
+template<typename Word>
+static bool any(Word word) {
+  uint64_t rows[sizeof(Word) / sizeof(uint64_t)];
+  std::memcpy(rows, &word, sizeof(Word));
+  uint64_t bits = 0;
+  for (const uint64_t row : rows) bits |= row;
+  return bits;
+}
+
+// Bits of the squares dx columns to the right
+template<typename Word>
+static Word shift(Word word, int dx) {
+  return dx > 0 ? word >> dx : word << -dx;
+}
+
+// Bit-sliced counters of up to 15
+template<typename Word>
+struct Counts {
+  Word bits[4] = {};
+
+  void add(Word word) {
+    for (Word &bit : bits) {
+      const Word carry = bit & word;
+      bit ^= word;
+      word = carry;
+    }
+  }
+
+  Counts operator+(const Counts &other) const {
+    Counts sum;
+    Word carry{};
+    for (int i=0; i<4; ++i) {
+      sum.bits[i] = bits[i] ^ other.bits[i] ^ carry;
+      carry = (bits[i] & other.bits[i]) | (carry & (bits[i] ^ other.bits[i]));
+    }
+    return sum;
+  }
+
+  Word greater(const Counts &other) const {
+    Word greater{}, equal = ~Word{};
+    for (int i=3; i>=0; --i) {
+      greater |= equal & bits[i] & ~other.bits[i];
+      equal &= ~(bits[i] ^ other.bits[i]);
+    }
+    return greater;
+  }
+
+  Word nonzero() const {
+    return bits[0] | bits[1] | bits[2] | bits[3];
   }
 };
 
-bool Board::resolve() {
-  if (check_status() != Status::RUNNING) return false;
-  const size_t max_nodes = 2 * m * n * MAXR;
-  for (size_t y=0; y<m; ++y) {
-    for (size_t x=0; x<n; ++x) {
-      Cell &cell = cells.at(y, x);
-      cell.previous_value = cell.value;
+// Sources of a 1x1 cell among 1x1 cells of the same orientation, by priority level
+// The other orientation has no effect. The sources of x cells are correlated at R4 and R16 and
+// anticorrelated at R8 and R20, and the other way around for + cells.
+struct PlainSource {
+  int dy, dx;
+};
+constexpr PlainSource PLAIN_SOURCES[] = {
+  {0, -1}, {0, 1}, {-1, 0}, {1, 0},
+  {-1, -1}, {-1, 1}, {1, -1}, {1, 1},
+  {0, -2}, {0, 2}, {-2, 0}, {2, 0},
+  {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {-2, -1}, {-2, 1}, {2, -1}, {2, 1},
+};
+constexpr size_t PLAIN_LEVEL_ENDS[] = {4, 8, 12, 20};
+constexpr bool PLAIN_LEVEL_ANTI_X[] = {false, true, false, true};
+
+// Decide the candidates of the rows starting at the padded row whose sources are all known
+// Return whether any cell was decided.
+template<typename Word>
+static bool decide_rows(Bitboard &bitboard, const CellPlanes &planes, size_t row) {
+  bool decided = false;
+  for (const bool x : {true, false}) {
+    const std::vector<uint64_t> &same = x ? planes.xs : planes.pluses;
+    const Word candidates = load<Word>(bitboard.candidates, row) & load<Word>(same, row) & ~load<Word>(bitboard.known, row);
+    if (!any(candidates)) continue;
+    Word blocked{};
+    for (const PlainSource &source : PLAIN_SOURCES) {
+      const size_t source_row = row + source.dy;
+      blocked |= shift(load<Word>(same, source_row) & ~load<Word>(bitboard.known, source_row), source.dx);
+    }
+    const Word ready = candidates & ~blocked;
+    if (!any(ready)) continue;
+    // the first priority level with a decisive vote sets the value, as for a cell with resolved sources
+    Word undecided = ready, ones{}, zeros{};
+    size_t begin = 0;
+    for (size_t level=0; level<sizeof(PLAIN_LEVEL_ENDS)/sizeof(PLAIN_LEVEL_ENDS[0]); ++level) {
+      Counts<Word> votes_one, votes_zero, undefined;
+      for (size_t i=begin; i<PLAIN_LEVEL_ENDS[level]; ++i) {
+        const PlainSource &source = PLAIN_SOURCES[i];
+        const size_t source_row = row + source.dy;
+        const Word sources = load<Word>(same, source_row);
+        const Word source_ones = shift(sources & load<Word>(bitboard.ones, source_row), source.dx);
+        const Word source_zeros = shift(sources & load<Word>(bitboard.zeros, source_row), source.dx);
+        const bool anti = PLAIN_LEVEL_ANTI_X[level] == x;
+        votes_one.add(anti ? source_zeros : source_ones);
+        votes_zero.add(anti ? source_ones : source_zeros);
+        undefined.add(shift(sources, source.dx) & ~source_ones & ~source_zeros);
+      }
+      begin = PLAIN_LEVEL_ENDS[level];
+      const Word one = votes_one.greater(votes_zero + undefined);
+      const Word zero = votes_zero.greater(votes_one + undefined);
+      ones |= undecided & one;
+      zeros |= undecided & zero;
+      undecided &= ~(one | zero | undefined.nonzero());
     }
+    // previous values break the remaining ties
+    ones |= undecided & load<Word>(planes.ones, row);
+    zeros |= undecided & load<Word>(planes.zeros, row);
+    store(bitboard.known, row, load<Word>(bitboard.known, row) | ready);
+    store(bitboard.ones, row, load<Word>(bitboard.ones, row) | ones);
+    store(bitboard.zeros, row, load<Word>(bitboard.zeros, row) | zeros);
+    decided = true;
   }
-  for (size_t i=0; i<inputs.size(); ++i) {
-    Cell &input_cell = cells.at(inputs[i].location);
-    input_cell.previous_value = input_bits[test_case][i][step] ? Cell::Value_::ONE : Cell::Value_::ZERO;
+  return decided;
+}
+
+// Decide the unlatched 1x1 cells of the rows from first to last with only 1x1 cells in range that do
+// not depend on cycles
+// Starting from the latched cells, cells whose sources are all known are decided a row of bits at a
+// time until no more are, with the same values as the solver gives them.
+static void decide_plain_cells(Bitboard &bitboard, const CellPlanes &planes, size_t first, size_t last) {
+  // padded rows in range of the candidates, and of the whole words of rows read past the last one
+  const size_t begin = first;
+  const size_t end = last + 2 * CellPlanes::PADDING + WORD_ROWS;
+  for (size_t row=begin; row<end; ++row) {
+    // latched cells keep their previous values
+    bitboard.known[row] = planes.latched[row];
+    bitboard.ones[row] = planes.latched[row] & planes.ones[row];
+    bitboard.zeros[row] = planes.latched[row] & planes.zeros[row];
+    bitboard.candidates[row] = 0;
   }
-  // NB: resolve() does not call itself, so static variables are okay
-  static Grid<std::array<Node, MAXR>> grid_nodes(m, n);
-  static Grid<std::array<Node, MAXR>> grid_antinodes(m, n);
-  // NB: Pointers into deques are safe.
-  static std::vector<Node*> nodes;
-  nodes.reserve(max_nodes);
-  nodes.clear();
-  // Construct nodes
-  for (size_t y=0; y<m; ++y) {
-    for (size_t x=0; x<n; ++x) {
-      const Location location(y, x);
-      Cell &cell = cells.at(location);
-      if (!cell) continue;
-
-      for (size_t r=0; r<MAXR; ++r) {
-        Node *node = &grid_nodes.at(location)[r];
-        Node *antinode = &grid_antinodes.at(location)[r];
-        nodes.push_back(node);
-        nodes.push_back(antinode);
-        // set node properties
-        node->location = location;
-        antinode->location = location;
-        node->anti = false;
-        antinode->anti = true;
-        node->r = r;
-        antinode->r = r;
-        node->antinode = antinode;
-        antinode->antinode = node;
-        node->cell = &cell;
-        antinode->cell = &cell;
-        node->value = Cell::Value_::UNKNOWN;
-        antinode->value = Cell::Value_::UNKNOWN;
-        node->nsources = 0;
-        antinode->nsources = 0;
-        node->source_index = 0;
-        antinode->source_index = 0;
-        if (r > 0) {
-          node->higher = &grid_nodes.at(location)[r - 1];
-          antinode->higher = &grid_antinodes.at(location)[r - 1];
-          node->sources[node->nsources++] = node->higher;
-          antinode->sources[antinode->nsources++] = antinode->higher;
-        } else {
-          node->higher = nullptr;
-          antinode->higher = nullptr;
-        }
-        if (r + 1 < MAXR) {
-          node->lower = &grid_nodes.at(location)[r + 1];
-          antinode->lower = &grid_antinodes.at(location)[r + 1];
-        } else {
-          node->lower = nullptr;
-          antinode->lower = nullptr;
-        }
-        node->use_lower = false;
-        antinode->use_lower = false;
-        node->index = 0;
-        antinode->index = 0;
-        node->lowlink = 0;
-        antinode->lowlink = 0;
-        node->on_stack = false;
-        antinode->on_stack = false;
-        node->in_subcall = false;
-        antinode->in_subcall = false;
+  for (size_t row=first+CellPlanes::PADDING; row<=last+CellPlanes::PADDING; ++row) {
+    uint64_t near_others = 0;
+    for (int dy=-RANGE; dy<=RANGE; ++dy) {
+      for (int dx=-RANGE; dx<=RANGE; ++dx) near_others |= shift(planes.others[row + dy], dx);
+    }
+    bitboard.candidates[row] = (planes.xs[row] | planes.pluses[row]) & ~planes.latched[row] & ~near_others;
+  }
+  for (bool decided=true; decided; ) {
+    decided = false;
+    for (size_t row=first+CellPlanes::PADDING; row<=last+CellPlanes::PADDING; row+=WORD_ROWS) {
+      if (decide_rows<PlaneWord>(bitboard, planes, row)) decided = true;
+    }
+  }
+}
+
+// Complete the cells of a cluster known from the bit planes, which are latched or decided
+// Return whether that was all of them.
+static bool complete_plain_cells(Nodes &nodes, const Bitboard &bitboard, const Grid<Cell> &cells,
+    const Square *begin, const Square *end) {
+  bool all = true;
+  for (const Square *square=begin; square!=end; ++square) {
+    const Location location = cells.location(*square);
+    const size_t row = location.y + CellPlanes::PADDING;
+    const uint64_t bit = uint64_t(1) << location.x;
+    if (!(bitboard.known[row] & bit)) {
+      all = false;
+      continue;
+    }
+    const Cell::Value value = bitboard.ones[row] & bit ? Cell::Value_::ONE :
+      bitboard.zeros[row] & bit ? Cell::Value_::ZERO : Cell::Value_::UNDEFINED;
+    complete(nodes, *square, value);
+  }
+  return all;
+}
+
+// Whether a component of cells can be resolved as a single contracted node
+// Plain unlatched cells affect each other symmetrically. When the component is connected at R4 and
+// the correlations are consistent, the nodes of the cells (or antinodes, by sign) at R0 and R4 form
+// one strongly connected component of the nodes that never reaches the opposite nodes. Each time it
+// is undetermined, the next priority level of every cell joins it, so the levels are tried in order
+// with the votes of all the cells combined, and the previous values of all the cells break ties.
+// Store the sign of each cell in the anti flag of its state.
+static bool contractible(const Grid<Influences> &influences, const Grid<Cell> &cells, WorkerStacks &stacks,
+    const Square *begin, const Square *end) {
+  std::vector<WorkerStacks::CellState> &cell_state = stacks.cell_state;
+  std::vector<Square> &queue = stacks.queue;
+  const size_t stride = cells.stride();
+  for (const Square *square=begin; square!=end; ++square) {
+    const Cell &cell = cells.at(*square);
+    if (cell.latched || cell.offset || cell.is_diode()) return false;
+  }
+  // assign signs over the R4 edges
+  queue.clear();
+  queue.push_back(*begin);
+  cell_state[*begin].anti = false;
+  cell_state[*begin].signed_ = true;
+  for (size_t i=0; i<queue.size(); ++i) {
+    const Square square = queue[i];
+    const Influences &influence = influences.at(square);
+    const bool anti = cell_state[square].anti;
+    for (size_t k=0; k<influence.nsources; ++k) {
+      const Influences::Source &source = influence.sources[k];
+      if (source.r != R4) continue;
+      const Square neighbor = source_square(square, source, stride);
+      WorkerStacks::CellState &neighbor_state = cell_state[neighbor];
+      if (!neighbor_state.on_stack || neighbor_state.signed_) continue;
+      neighbor_state.anti = anti ^ source.anti;
+      neighbor_state.signed_ = true;
+      queue.push_back(neighbor);
+    }
+  }
+  if (queue.size() != static_cast<size_t>(end - begin)) return false;
+  // check the correlations of all edges within the component
+  for (const Square *square=begin; square!=end; ++square) {
+    const Influences &influence = influences.at(*square);
+    const bool anti = cell_state[*square].anti;
+    for (size_t k=0; k<influence.nsources; ++k) {
+      const Influences::Source &source = influence.sources[k];
+      const WorkerStacks::CellState &neighbor_state = cell_state[source_square(*square, source, stride)];
+      if (neighbor_state.on_stack && neighbor_state.anti != (anti ^ source.anti)) return false;
+    }
+  }
+  return true;
+}
+
+// Whether a component of cells can be resolved by propagation, when its sources outside the component
+// are all resolved and it is a single cell or contractible
+static bool propagatable(const Nodes &nodes, WorkerStacks &stacks, const Grid<Influences> &influences,
+    const Grid<Cell> &cells, const Square *begin, const Square *end) {
+  const std::vector<WorkerStacks::CellState> &cell_state = stacks.cell_state;
+  const size_t stride = cells.stride();
+  for (const Square *square=begin; square!=end; ++square) {
+    const Influences &influence = influences.at(*square);
+    for (size_t k=0; k<influence.nsources; ++k) {
+      const Influences::Source &source = influence.sources[k];
+      if (!cell_state[source_square(*square, source, stride)].on_stack &&
+          !nodes.materialized(source_node(nodes, influence, cells, *square, source, R0))) {
+        return false;
       }
     }
   }
+  return end - begin == 1 || contractible(influences, cells, stacks, begin, end);
+}
 
-  // find and add edges
-  for (size_t y=0; y<m; ++y) {
-    for (size_t x=0; x<n; ++x) {
-      const Location location(y, x);
-      Cell &cell = cells.at(location);
-      if (!cell) continue;
-      for (int dy=-RANGE; dy<=RANGE; ++dy) {
-        for (int dx=-RANGE; dx<=RANGE; ++dx) {
-          if (dy == 0 && dx == 0) continue;
-          const Location delta(dy, dx);
-          const Location neighbor_location = location + delta;
-          if (!cells.valid(neighbor_location)) continue;
-          Cell &neighbor = cells.at(neighbor_location);
-          if (!neighbor) continue;
-          // calculate R distance (double coordinates and account for offset)
-          Location dist_delta(2 * dy, 2 * dx);
-          if (cell.offset) dist_delta = dist_delta + Location(cell.direction);
-          if (neighbor.offset) dist_delta = dist_delta - Location(neighbor.direction);
-          const uint8_t dist = sqr(dist_delta.y) + sqr(dist_delta.x);
-          // opposite orientation in same alignment have no effect
-          if (cell.x != neighbor.x && cell.offset == neighbor.offset) continue;
-          // opposite orientation in the same axis have not effect
-          if (cell.x != neighbor.x && (dist_delta.y == 0 || dist_delta.x == 0)) continue;
-          R r = R::FromInt(dist);
-          // distance beyond simulated range of effect
-          if (r == MAXR) continue;
-          Node *node = &grid_nodes.at(location)[r];
-          Node *antinode = &grid_antinodes.at(location)[r];
-          Node *neighbor_node = &grid_nodes.at(neighbor_location)[r];
-          Node *neighbor_antinode = &grid_antinodes.at(neighbor_location)[r];
-          // compute whether cells are correlated or anticorrelated
-          bool anti;
-          if (cell.x == neighbor.x) anti = cell.x ^ (dist_delta.y == 0 || dist_delta.x == 0);
-          else anti = (dist_delta.y > dist_delta.x) ^ (-dist_delta.y > dist_delta.x) ^ (dist_delta.y * dist_delta.x < 0);
-          if (cell.is_diode() && cell.partner_delta * dist_delta > 1) {
-            // cell.s a diode and neighbor is closer to diode partner
-            if (cell.partner_delta != delta) continue;
-            // partner is the sink not the source
-            if (!cell.latched) continue;
-          }
-          if (neighbor.is_diode() && neighbor.partner_delta * dist_delta < -1) {
-            // neighbor is a diode and cell.s closer to diode partner
-            if (cell.partner_delta != delta) continue;
-          }
-          // only latched diodes cells can be affected
-          if (cell.latched && !(cell.is_diode() && cell.partner_delta == delta)) continue;
-          // add edges
-          node->sources[node->nsources++] = anti ? neighbor_antinode : neighbor_node;
-          antinode->sources[antinode->nsources++] = anti ? neighbor_node : neighbor_antinode;
+// Resolve a propagatable component of cells
+static void propagate_component(Nodes &nodes, const WorkerStacks &stacks, const Grid<Influences> &influences,
+    const Grid<Cell> &cells, const Square *begin, const Square *end) {
+  const std::vector<WorkerStacks::CellState> &cell_state = stacks.cell_state;
+  const size_t stride = cells.stride();
+  // combine the votes of the cells at each priority level
+  std::array<Cell::Value, MAXR> votes{};
+  for (const Square *square=begin; square!=end; ++square) {
+    const Influences &influence = influences.at(*square);
+    const bool anti = cell_state[*square].anti;
+    std::array<int, MAXR> weight{};
+    std::array<int, MAXR> undefined{};
+    for (size_t k=0; k<influence.nsources; ++k) {
+      const Influences::Source &source = influence.sources[k];
+      if (cell_state[source_square(*square, source, stride)].on_stack) continue;
+      const Nodes::Index neighbor_node = source_node(nodes, influence, cells, *square, source, R0);
+      switch (nodes.value[source.anti ^ anti ? Nodes::antinode(neighbor_node) : neighbor_node]) {
+      case Cell::Value_::ZERO:
+        --weight[source.r]; break;
+      case Cell::Value_::ONE:
+        ++weight[source.r]; break;
+      case Cell::Value_::UNKNOWN:
+      case Cell::Value_::UNDEFINED:
+        ++undefined[source.r]; break;
+      }
+    }
+    for (size_t r=0; r<MAXR; ++r) {
+      if (weight[r] > undefined[r]) votes[r] += Cell::Value_::ONE;
+      else if (weight[r] < -undefined[r]) votes[r] += Cell::Value_::ZERO;
+      else if (undefined[r]) votes[r] = Cell::Value_::UNDEFINED;
+    }
+  }
+  Cell::Value value = Cell::Value_::UNKNOWN;
+  for (size_t r=0; r<MAXR && !value; ++r) value = votes[r];
+  if (!value) {
+    // use previous values
+    for (const Square *square=begin; square!=end; ++square) {
+      const Cell::Value previous_value = cells.at(*square).previous_value;
+      value += cell_state[*square].anti ? -previous_value : previous_value;
+    }
+    if (!value) value = Cell::Value_::UNDEFINED;
+  }
+  for (const Square *square=begin; square!=end; ++square) {
+    complete(nodes, *square, cell_state[*square].anti ? -value : value);
+  }
+}
+
+// Bit-sliced count of up to 15 in each lane
+struct LaneCount {
+  std::array<uint64_t, 4> bits{};
+  void add(uint64_t lanes) {
+    for (uint64_t &bit : bits) {
+      const uint64_t carry = bit & lanes;
+      bit ^= lanes;
+      lanes = carry;
+    }
+  }
+  LaneCount operator+(const LaneCount &oth) const {
+    LaneCount sum;
+    uint64_t carry = 0;
+    for (size_t i=0; i<bits.size(); ++i) {
+      sum.bits[i] = bits[i] ^ oth.bits[i] ^ carry;
+      carry = (bits[i] & oth.bits[i]) | (carry & (bits[i] ^ oth.bits[i]));
+    }
+    return sum;
+  }
+  // lanes where the count is greater than the other
+  uint64_t greater(const LaneCount &oth) const {
+    uint64_t greater = 0;
+    uint64_t equal = ~uint64_t(0);
+    for (size_t i=bits.size(); i-->0;) {
+      greater |= equal & bits[i] & ~oth.bits[i];
+      equal &= ~(bits[i] ^ oth.bits[i]);
+    }
+    return greater;
+  }
+  uint64_t nonzero() const { return bits[0] | bits[1] | bits[2] | bits[3]; }
+};
+static_assert(Nodes::MAX_DEGREE < 16, "counts of the sources at a level fit in a LaneCount");
+
+// Resolve a propagatable component of cells in the lanes at once
+// The sums of values are the unions of their bits, so the votes combine like in propagate_component.
+// Mark the cells as resolved in the nodes for the components that have them as sources.
+static void propagate_lane_component(Nodes &nodes, const WorkerStacks &stacks, const Grid<Influences> &influences,
+    const Grid<Cell> &cells, const std::vector<LaneValue> &previous_values, std::vector<LaneValue> &values,
+    uint64_t lanes, const Square *begin, const Square *end) {
+  const std::vector<WorkerStacks::CellState> &cell_state = stacks.cell_state;
+  const size_t stride = cells.stride();
+  std::array<LaneValue, MAXR> votes{};
+  for (const Square *square=begin; square!=end; ++square) {
+    const Influences &influence = influences.at(*square);
+    const bool anti = cell_state[*square].anti;
+    std::array<LaneCount, MAXR> ones{};
+    std::array<LaneCount, MAXR> zeros{};
+    std::array<LaneCount, MAXR> undefined{};
+    for (size_t k=0; k<influence.nsources; ++k) {
+      const Influences::Source &source = influence.sources[k];
+      const Square neighbor = source_square(*square, source, stride);
+      if (cell_state[neighbor].on_stack) continue;
+      LaneValue value = influence.fixed & Influences::bit(source.dy, source.dx) ?
+        LaneValue(cells.at(neighbor).value) : values[neighbor];
+      if (source.anti ^ anti) value = -value;
+      ones[source.r].add(value.hi & ~value.lo);
+      zeros[source.r].add(value.lo & ~value.hi);
+      undefined[source.r].add(~(value.lo ^ value.hi));
+    }
+    for (size_t r=0; r<MAXR; ++r) {
+      const uint64_t one = ones[r].greater(zeros[r] + undefined[r]);
+      const uint64_t zero = zeros[r].greater(ones[r] + undefined[r]);
+      const uint64_t undecided = undefined[r].nonzero() & ~one & ~zero;
+      votes[r].hi |= one | undecided;
+      votes[r].lo |= zero | undecided;
+    }
+  }
+  LaneValue value;
+  uint64_t undecided = lanes;
+  for (size_t r=0; r<MAXR && undecided; ++r) {
+    const uint64_t decided = undecided & (votes[r].lo | votes[r].hi);
+    value.set(decided, votes[r]);
+    undecided &= ~decided;
+  }
+  if (undecided) {
+    // use previous values
+    LaneValue previous_value;
+    for (const Square *square=begin; square!=end; ++square) {
+      const LaneValue &cell_previous_value = previous_values[*square];
+      previous_value.lo |= cell_state[*square].anti ? cell_previous_value.hi : cell_previous_value.lo;
+      previous_value.hi |= cell_state[*square].anti ? cell_previous_value.lo : cell_previous_value.hi;
+    }
+    value.set(undecided, previous_value);
+    undecided &= ~(previous_value.lo | previous_value.hi);
+    value.set(undecided, Cell::Value(Cell::Value_::UNDEFINED));
+  }
+  for (const Square *square=begin; square!=end; ++square) {
+    values[*square].set(lanes, cell_state[*square].anti ? -value : value);
+    nodes.stamp[Nodes::index(*square, 0, false) >> 1] = nodes.epoch;
+  }
+}
+
+// Resolve the cells of a cluster by propagating values through the strongly connected components
+// of the cells in topological order, contracting each component into a single node when possible.
+// A single cell without cycles is its own strongly connected component of the nodes at each level,
+// so the priority levels of the cell are tried in order until the sources at one level decide.
+// Which components propagate depends only on the cells and not on their values, and propagate is
+// called for each of them to resolve it.
+// Return whether all the cells were resolved.
+template<typename Propagate>
+static bool propagate_cluster(const Nodes &nodes, WorkerStacks &stacks, const Grid<Influences> &influences,
+    const Grid<Cell> &cells, const Square *begin, const Square *end, const Propagate &propagate) {
+  std::vector<WorkerStacks::CellState> &cell_state = stacks.cell_state;
+  std::vector<Square> &callstack = stacks.cell_callstack;
+  std::vector<Square> &scc = stacks.cell_scc;
+  const size_t stride = cells.stride();
+  for (const Square *square=begin; square!=end; ++square) cell_state[*square] = WorkerStacks::CellState();
+  // Tarjan's algorithm on the cells, which completes components after the components of their sources
+  size_t resolved = 0;
+  int index = 1;
+  for (const Square *root=begin; root!=end; ++root) {
+    if (cell_state[*root].index) continue;
+    callstack.push_back(*root);
+    while (!callstack.empty()) {
+      const Square square = callstack.back();
+      WorkerStacks::CellState &state = cell_state[square];
+      const Influences &influence = influences.at(square);
+      if (!state.index) {
+        state.lowlink = state.index = index++;
+        scc.push_back(square);
+        state.on_stack = true;
+      }
+      bool in_subcall = false;
+      while (!in_subcall && state.source_index < influence.nsources) {
+        const Influences::Source &source = influence.sources[state.source_index++];
+        // constant cells are outside the cluster
+        if (influence.fixed & Influences::bit(source.dy, source.dx)) continue;
+        const Square neighbor = source_square(square, source, stride);
+        const WorkerStacks::CellState &neighbor_state = cell_state[neighbor];
+        if (!neighbor_state.index) {
+          callstack.push_back(neighbor);
+          in_subcall = true;
+        } else if (neighbor_state.on_stack) {
+          state.lowlink = std::min(state.lowlink, neighbor_state.index);
+        }
+      }
+      if (in_subcall) continue;
+      callstack.pop_back();
+      if (!callstack.empty()) {
+        WorkerStacks::CellState &parent_state = cell_state[callstack.back()];
+        parent_state.lowlink = std::min(parent_state.lowlink, state.lowlink);
+      }
+      if (state.lowlink == state.index) {
+        // component is on top of the stack
+        size_t component = scc.size();
+        while (scc[--component] != square);
+        const Square *component_begin = &scc[component];
+        const Square *component_end = &scc[0] + scc.size();
+        if (propagatable(nodes, stacks, influences, cells, component_begin, component_end)) {
+          propagate(component_begin, component_end);
+          resolved += scc.size() - component;
         }
+        for (size_t i=component; i<scc.size(); ++i) cell_state[scc[i]].on_stack = false;
+        scc.resize(component);
       }
     }
   }
+  return resolved == static_cast<size_t>(end - begin);
+}
+
+// Resolve the cells of a cluster by propagation as far as possible, completing them at R0, where
+// Tarjan's algorithm will find them for the remaining cells.
+static bool propagate_cluster(Nodes &nodes, WorkerStacks &stacks, const Grid<Influences> &influences,
+    const Grid<Cell> &cells, const Square *begin, const Square *end) {
+  return propagate_cluster(nodes, stacks, influences, cells, begin, end, [&](const Square *begin, const Square *end) {
+    propagate_component(nodes, stacks, influences, cells, begin, end);
+  });
+}
 
-  // Tarjan's algorithm
-  static std::vector<Node*> callstack;
-  callstack.reserve(max_nodes);
-  callstack.clear();
-  static std::vector<Node*> scc;
-  scc.reserve(max_nodes);
-  scc.clear();
-  static std::vector<Node*> scc_initial;
-  scc_initial.reserve(max_nodes);
-  scc_initial.clear();
+// Clusters do not share nodes, so they can be resolved concurrently.
+void resolve_cluster(Nodes &nodes, const Grid<Influences> &influences, const Grid<Cell> &cells,
+    WorkerStacks &stacks, const Square *begin, const Square *end) {
+  std::vector<Nodes::Index> &callstack = stacks.callstack;
+  std::vector<Nodes::Index> &scc = stacks.scc;
+  std::vector<Nodes::Index> &scc_initial = stacks.scc_initial;
+  for (const Square *square=begin; square!=end; ++square) {
+    const Nodes::Index node = Nodes::index(*square, 0, false);
+    if (!nodes.materialized(node)) materialize(nodes, influences, cells, node);
+  }
   int index = 1;
-  for (Node *start : nodes) {
-    if (!start->index) {
+  for (const Square *cell_square=begin; cell_square!=end; ++cell_square) {
+    const Square square = *cell_square;
+    // lower priority nodes started here would only copy the higher node
+    for (const Nodes::Index start : {Nodes::index(square, 0, false), Nodes::index(square, 0, true)}) {
+      if (nodes.state[start].index) continue;
       callstack.push_back(start);
       while (!callstack.empty()) {
-        Node *node = callstack.back();
-        if (node->in_subcall) {
+        const Nodes::Index node = callstack.back();
+        Nodes::State &state = nodes.state[node];
+        Nodes::Index *sources = nodes.sources_of(node);
+        const Nodes::Index higher = Nodes::higher(node);
+        if (state.in_subcall) {
           // call to child was finished
-          node->lowlink = std::min(node->lowlink, node->sources[node->source_index - 1]->lowlink);
-          node->in_subcall = false;
+          state.lowlink = std::min(state.lowlink, nodes.state[sources[state.source_index - 1]].lowlink);
+          state.in_subcall = false;
           // if source was same node at higher priority and was completed, we only need that
-          if (node->higher && node->higher->value) node->nsources = 1;
-        } else if (!node->index) {
+          if (higher != Nodes::NONE && nodes.value[higher]) nodes.nsources[node] = 1;
+        } else if (!state.index) {
           // start
-          node->lowlink = node->index = index++;
+          state.lowlink = state.index = index++;
           scc.push_back(node);
-          node->on_stack = true;
+          state.on_stack = true;
           scc_initial.push_back(node);
         }
-        Node *next = nullptr;
-        while (!next && node->source_index < node->nsources) {
-          next = node->sources[node->source_index++];
+        Nodes::Index next = Nodes::NONE;
+        while (next == Nodes::NONE && state.source_index < nodes.nsources[node]) {
+          next = sources[state.source_index++];
         }
-        if (next) {
-          if (next == node->higher && node->higher->value) {
+        if (next != Nodes::NONE && !nodes.materialized(next)) materialize(nodes, influences, cells, next);
+        if (next != Nodes::NONE) {
+          if (next == higher && nodes.value[higher]) {
             // if source was same node at higher priority and was completed, we only need that
-            node->nsources = 1;
-          } else if (!next->index) {
+            nodes.nsources[node] = 1;
+          } else if (!nodes.state[next].index) {
             callstack.push_back(next);
-            node->in_subcall = true;
-          } else if (next->on_stack) {
-            node->lowlink = std::min(node->lowlink, next->index);
+            state.in_subcall = true;
+          } else if (nodes.state[next].on_stack) {
+            state.lowlink = std::min(state.lowlink, nodes.state[next].index);
           }
         } else {
           bool keep_on_callstack = false;
-          if (node->lowlink == node->index) {
+          if (state.lowlink == state.index) {
             // subtree finished and node is root of an SCC
             Cell::Value value = Cell::Value_::UNKNOWN;
-            for (auto it=scc_initial.rbegin(); it!=scc_initial.rend() && (*it)->index >= node->index; ++it) {
+            for (auto it=scc_initial.rbegin(); it!=scc_initial.rend() && nodes.state[*it].index >= state.index; ++it) {
               int weight = 0;
               int undefined = 0;
-              for (size_t i=0; i<(*it)->nsources; ++i) {
-                if ((*it)->sources[i] &&
-                    !(*it)->sources[i]->on_stack) {
-                  switch((*it)->sources[i]->value) {
+              const Nodes::Index *initial_sources = nodes.sources_of(*it);
+              for (size_t i=0; i<nodes.nsources[*it]; ++i) {
+                const Nodes::Index source = initial_sources[i];
+                if (source != Nodes::NONE && !nodes.state[source].on_stack) {
+                  switch(nodes.value[source]) {
                   case Cell::Value_::ZERO:
                     --weight; break;
                   case Cell::Value_::ONE:
@@ -312,42 +851,49 @@ bool Board::resolve() {
             if (!value) {
               // add edges from lower priority level (increase radius of effect)
               // back()->index strictly greater than node->index since we handle root separately
-              while (!scc_initial.empty() && scc_initial.back()->index >= node->index) {
-                Node *initial_node = scc_initial.back();
+              while (!scc_initial.empty() && nodes.state[scc_initial.back()].index >= state.index) {
+                const Nodes::Index initial_node = scc_initial.back();
                 scc_initial.pop_back();
-                if (initial_node->lower && !initial_node->use_lower) {
-                  initial_node->sources[initial_node->nsources++] = initial_node->lower;
-                  initial_node->use_lower = true;
+                const Nodes::Index lower = Nodes::lower(initial_node);
+                Nodes::State &initial_state = nodes.state[initial_node];
+                if (lower != Nodes::NONE && !initial_state.use_lower) {
+                  if (!nodes.materialized(lower)) materialize(nodes, influences, cells, lower);
+                  nodes.sources_of(initial_node)[nodes.nsources[initial_node]++] = lower;
+                  initial_state.use_lower = true;
                   if (initial_node != node) callstack.push_back(initial_node);
                   keep_on_callstack = true;
                   // kill edges from same strongly connected component
-                  for (size_t i=0; i<initial_node->lower->nsources; ++i) {
-                    if (initial_node->lower->sources[i] &&
-                        initial_node->lower->sources[i]->antinode->higher &&
-                        initial_node->lower->sources[i]->antinode->higher->on_stack &&
-                        initial_node->lower->sources[i]->antinode->higher->index >= node->index) {
-                      initial_node->lower->sources[i] = nullptr;
+                  Nodes::Index *lower_sources = nodes.sources_of(lower);
+                  for (size_t i=0; i<nodes.nsources[lower]; ++i) {
+                    if (lower_sources[i] == Nodes::NONE) continue;
+                    const Nodes::Index anti_higher = Nodes::higher(Nodes::antinode(lower_sources[i]));
+                    if (anti_higher != Nodes::NONE &&
+                        nodes.materialized(anti_higher) &&
+                        nodes.state[anti_higher].on_stack &&
+                        nodes.state[anti_higher].index >= state.index) {
+                      lower_sources[i] = Nodes::NONE;
                     }
                   }
                 }
               }
               if (!keep_on_callstack) {
                 // use previous values
-                for (auto it=scc.rbegin(); it!=scc.rend() && (*it)->index >= node->index; ++it) {
-                  value += (*it)->anti ? -(*it)->cell->previous_value : (*it)->cell->previous_value;
+                for (auto it=scc.rbegin(); it!=scc.rend() && nodes.state[*it].index >= state.index; ++it) {
+                  const Cell::Value previous_value = cells.at(static_cast<Square>(Nodes::square(*it))).previous_value;
+                  value += Nodes::anti(*it) ? -previous_value : previous_value;
                 }
                 if (!value) value = Cell::Value_::UNDEFINED;
               }
             } else {
               // pop scc_initial
-              while (!scc_initial.empty() && scc_initial.back()->index >= node->index) {
+              while (!scc_initial.empty() && nodes.state[scc_initial.back()].index >= state.index) {
                 scc_initial.pop_back();
               }
             }
             if (value) {
-              while (!scc.empty() && scc.back()->index >= node->index) {
-                scc.back()->value = value;
-                scc.back()->on_stack = false;
+              while (!scc.empty() && nodes.state[scc.back()].index >= state.index) {
+                nodes.value[scc.back()] = value;
+                nodes.state[scc.back()].on_stack = false;
                 scc.pop_back();
               }
             }
@@ -360,17 +906,248 @@ bool Board::resolve() {
       }
     }
   }
+}
 
-  // populate new cell values
+// Add the cluster containing the cell in the square to the region if it is not already there
+static void add_cluster(Workspace &workspace, const Grid<Influences> &influences, const Grid<Cell> &cells,
+    const Grid<bool> &constant, Square seed) {
+  if (!cells.at(seed) || constant.at(seed) || workspace.in_region.at(seed)) return;
+  const size_t begin = workspace.region.size();
+  workspace.in_region.at(seed) = true;
+  workspace.region.push_back(seed);
+  for (size_t i=begin; i<workspace.region.size(); ++i) {
+    const Square square = workspace.region[i];
+    // linked squares are on the board
+    for (uint32_t linked=influences.at(square).linked; linked; linked&=linked-1) {
+      const Square neighbor = square + workspace.offsets[__builtin_ctz(linked)];
+      if (workspace.in_region.at(neighbor)) continue;
+      workspace.in_region.at(neighbor) = true;
+      workspace.region.push_back(neighbor);
+    }
+  }
+  // resolution depends on the order of the nodes
+  std::sort(workspace.region.begin() + begin, workspace.region.end());
+  workspace.clusters.push_back(workspace.region.size());
+}
+
+// Resolve-relevant state of a cell
+static uint16_t signature(const Cell &cell) {
+  if (!cell) return 0;
+  return 1 |
+    cell.x << 1 |
+    cell.latched << 2 |
+    cell.offset << 3 |
+    static_cast<uint16_t>(static_cast<Direction_>(cell.direction)) << 4 |
+    static_cast<uint16_t>(cell.partner) << 7 |
+    static_cast<uint16_t>(static_cast<Cell::Value_>(cell.previous_value)) << 10;
+}
+
+// Zobrist key for a square having a signature (splitmix64 instead of a random table)
+static uint64_t zobrist(size_t square, uint16_t signature) {
+  uint64_t z = (static_cast<uint64_t>(square) << 16 | signature) + 0x9e3779b97f4a7c15;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+bool Board::resolve() {
+  if (check_status() != Status::RUNNING) return false;
+  const size_t squares = cells.squares();
+  // workers are made by the first resolve, even if it does not need them, so later resolves do not allocate
+  workspace->add_stacks(resolve_threads);
+  if (resolve_threads > 1 && (!workspace->pool || workspace->pool->size() != resolve_threads)) {
+    workspace->pool.reset(new WorkerPool(resolve_threads));
+  }
   for (size_t y=0; y<m; ++y) {
     for (size_t x=0; x<n; ++x) {
-      const Location location(y, x);
-      Cell &cell = cells.at(location);
-      // highest priority node has the value
-      const Node &node = grid_nodes.at(location)[0];
-      if (cell) cell.value = node.value;
+      Cell &cell = cells.at(y, x);
+      if (cell.previous_value == cell.value) continue;
+      journal_cell(Location(y, x));
+      cell.previous_value = cell.value;
+    }
+  }
+  if (simulating_lanes) {
+    lane_previous_values = lane_values;
+    for (size_t i=0; i<inputs.size(); ++i) {
+      const Location &location = inputs[i].location;
+      LaneValue &input = lane_previous_values[cells.square(location)];
+      for (uint64_t remaining=lanes; remaining; remaining&=remaining-1) {
+        const size_t lane = __builtin_ctzll(remaining);
+        input.set(uint64_t(1) << lane, Cell::Value(input_bits[lane_test_cases[lane]][i][step] ? Cell::Value_::ONE : Cell::Value_::ZERO));
+      }
+      cells.at(location).previous_value = input.get(__builtin_ctzll(lanes));
+      if (input.differ(lane_values[cells.square(location)]) & lanes) mark_dirty(location);
+    }
+  } else {
+    for (size_t i=0; i<inputs.size(); ++i) {
+      journal_cell(inputs[i].location);
+      Cell &input_cell = cells.at(inputs[i].location);
+      input_cell.previous_value = input_bits[test_case][i][step] ? Cell::Value_::ONE : Cell::Value_::ZERO;
+      if (input_cell.previous_value != input_cell.value) mark_dirty(inputs[i].location);
+    }
+  }
+  // update the hash and the bit planes of the squares that changed
+  for (const Square square : changed) {
+    uint16_t &old_signature = signatures.at(square);
+    const uint16_t new_signature = signature(cells.at(square));
+    signature_hash ^= zobrist(square, old_signature) ^ zobrist(square, new_signature);
+    old_signature = new_signature;
+  }
+  if (n <= CellPlanes::MAX_COLS) {
+    for (const Square square : changed) {
+      const Location location = cells.location(square);
+      planes.set(location.y, location.x, cells.at(square));
     }
   }
+  // look up memoized values
+  const size_t cache_entry = signature_hash & (resolve_cache.entries - 1);
+  if (resolve_cache.entries && !simulating_lanes) {
+    uint16_t *cache_signatures = &resolve_cache.signatures[cache_entry * squares];
+    Cell::Value *cache_values = &resolve_cache.values[cache_entry * squares];
+    if (resolve_cache.valid[cache_entry] &&
+        resolve_cache.hashes[cache_entry] == signature_hash &&
+        std::equal(cache_signatures, cache_signatures + squares, &signatures.at(Square(0)))) {
+      ++resolve_cache.hits;
+      for (const Square square : changed) dirty.at(square) = false;
+      changed.clear();
+      for (Square square=0; square<squares; ++square) {
+        Cell &cell = cells.at(square);
+        if (!cell) continue;
+        if (cell.value != cache_values[square]) journal_cell(square);
+        cell.value = cache_values[square];
+        if (cell.value != cell.previous_value) mark_dirty(square);
+      }
+      return false;
+    }
+    ++resolve_cache.misses;
+  }
+  std::vector<Square> &region = workspace->region;
+  std::vector<size_t> &clusters = workspace->clusters;
+  workspace->in_region.reset(false);
+  region.clear();
+  clusters.clear();
+  // Find the cells to resolve as clusters, the connected components of the interaction graph
+  // Clusters without changed squares in range keep their values.
+  if (incremental_resolve) {
+    // squares in range off the board are empty squares of the halo
+    for (const Square square : changed) {
+      for (const int offset : workspace->offsets) add_cluster(*workspace, influences, cells, constant, square + offset);
+    }
+  } else {
+    for (Square square=0; square<squares; ++square) add_cluster(*workspace, influences, cells, constant, square);
+  }
+  for (const Square square : changed) dirty.at(square) = false;
+  changed.clear();
+  Nodes &nodes = workspace->nodes;
+  // lower priority nodes are constructed when referenced
+  nodes.next_epoch();
+
+  // Plain cells outside of cycles are decided in bulk, except in lanes with their own previous values
+  const bool plain_bitboard = resolve_engine == ResolveEngine::BITBOARD && n <= CellPlanes::MAX_COLS &&
+    !simulating_lanes && !region.empty();
+  if (plain_bitboard) {
+    const auto squares = std::minmax_element(region.begin(), region.end());
+    decide_plain_cells(workspace->bitboard, planes, cells.location(*squares.first).y, cells.location(*squares.second).y);
+  }
+
+  // Resolve clusters
+  const auto run_cluster = [&](size_t worker, size_t cluster) {
+    WorkerStacks &stacks = workspace->stacks[worker];
+    const Square *begin = &region[cluster ? clusters[cluster - 1] : 0];
+    const Square *end = &region[0] + clusters[cluster];
+    if (resolve_pairs && resolve_pair(nodes, influences, cells, begin, end)) return;
+    if (resolve_engine == ResolveEngine::WORKLIST && propagate_cluster(nodes, stacks, influences, cells, begin, end)) return;
+    if (plain_bitboard && complete_plain_cells(nodes, workspace->bitboard, cells, begin, end)) return;
+    resolve_cluster(nodes, influences, cells, stacks, begin, end);
+  };
+  const size_t nworkers = resolve_threads > 1 && clusters.size() > 1 && region.size() >= parallel_resolve_min_cells ?
+    resolve_threads : 1;
+
+  if (simulating_lanes) {
+    // Resolve the clusters that propagate in all the lanes at once with the bits of the values, and each
+    // of the others once for every combination of previous values of its cells among the lanes
+    // The solver branches on the values, so lanes share its work instead of running it bit-sliced.
+    std::vector<uint64_t> &pending_lanes = workspace->pending_lanes;
+    std::vector<size_t> &lane_clusters = workspace->lane_clusters;
+    pending_lanes.assign(clusters.size(), lanes);
+    const auto propagate_lanes = [&](size_t worker, size_t cluster) {
+      WorkerStacks &stacks = workspace->stacks[worker];
+      const Square *begin = &region[cluster ? clusters[cluster - 1] : 0];
+      const Square *end = &region[0] + clusters[cluster];
+      if (propagate_cluster(nodes, stacks, influences, cells, begin, end, [&](const Square *begin, const Square *end) {
+        propagate_lane_component(nodes, stacks, influences, cells, lane_previous_values, lane_values, lanes, begin, end);
+      })) {
+        pending_lanes[cluster] = 0;
+      }
+    };
+    if (nworkers > 1) {
+      workspace->pool->run(clusters.size(), propagate_lanes);
+    } else {
+      for (size_t cluster=0; cluster<clusters.size(); ++cluster) propagate_lanes(0, cluster);
+    }
+    lane_clusters.clear();
+    for (size_t cluster=0; cluster<clusters.size(); ++cluster) {
+      if (pending_lanes[cluster]) lane_clusters.push_back(cluster);
+    }
+    while (!lane_clusters.empty()) {
+      // a cluster is resolved at most once per epoch
+      nodes.next_epoch();
+      const auto resolve_lanes = [&](size_t worker, size_t job) {
+        const size_t cluster = lane_clusters[job];
+        const Square *begin = &region[cluster ? clusters[cluster - 1] : 0];
+        const Square *end = &region[0] + clusters[cluster];
+        const size_t lane = __builtin_ctzll(pending_lanes[cluster]);
+        uint64_t same = pending_lanes[cluster];
+        for (const Square *square=begin; square!=end; ++square) {
+          const LaneValue &previous_value = lane_previous_values[*square];
+          cells.at(*square).previous_value = previous_value.get(lane);
+          same &= ~previous_value.differ(previous_value.get(lane));
+        }
+        run_cluster(worker, cluster);
+        for (const Square *square=begin; square!=end; ++square) {
+          lane_values[*square].set(same, nodes.value[Nodes::index(*square, 0, false)]);
+        }
+        pending_lanes[cluster] &= ~same;
+      };
+      if (nworkers > 1) {
+        workspace->pool->run(lane_clusters.size(), resolve_lanes);
+      } else {
+        for (size_t job=0; job<lane_clusters.size(); ++job) resolve_lanes(0, job);
+      }
+      lane_clusters.erase(std::remove_if(lane_clusters.begin(), lane_clusters.end(),
+        [&](size_t cluster) { return !pending_lanes[cluster]; }), lane_clusters.end());
+    }
+    for (const Square square : region) {
+      if (lane_values[square].differ(lane_previous_values[square]) & lanes) mark_dirty(square);
+    }
+    sync_lanes();
+    return false;
+  }
+
+  if (nworkers > 1) {
+    workspace->pool->run(clusters.size(), run_cluster);
+  } else {
+    for (size_t cluster=0; cluster<clusters.size(); ++cluster) run_cluster(0, cluster);
+  }
+
+  // populate new cell values
+  for (const Square square : region) {
+    Cell &cell = cells.at(square);
+    // highest priority node has the value
+    if (cell.value != nodes.value[Nodes::index(square, 0, false)]) journal_cell(square);
+    cell.value = nodes.value[Nodes::index(square, 0, false)];
+    // resolve again if the values have not reached a fixed point
+    if (cell.value != cell.previous_value) mark_dirty(square);
+  }
+
+  // memoize the values
+  if (resolve_cache.entries) {
+    resolve_cache.valid[cache_entry] = true;
+    resolve_cache.hashes[cache_entry] = signature_hash;
+    std::copy(&signatures.at(Square(0)), &signatures.at(Square(0)) + squares, &resolve_cache.signatures[cache_entry * squares]);
+    Cell::Value *cache_values = &resolve_cache.values[cache_entry * squares];
+    for (Square square=0; square<squares; ++square) cache_values[square] = cells.at(square).value;
+  }
 
   return false;
 }
@@ -2,27 +2,79 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdio>
+#include <cstring>
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <set>
 #include <sstream>
 #include <string>
-#include <stack>
 #include <tuple>
 #include <vector>
 #include <utility>
 
+#include "resolve.h"
+
 namespace puzzle {
 
 constexpr bool ROTATE_TAKES_TURN = false;
+constexpr size_t DEFAULT_RESOLVE_CACHE_SIZE = 64;
 
 const Error Error::BoardSizeMismatch("Board size mismatch", ErrorReason::INVALID_INPUT);
 const Error Error::InvalidInput("Invalid input", ErrorReason::INVALID_INPUT);
 const Error Error::InvalidLevelFormat("Invalid level format", ErrorReason::INVALID_LEVEL);
 const Error Error::OutOfRange("Out of range error", ErrorReason::RUNTIME_ERROR);
 
+Error Error::TooManyCycles(size_t max_cycles) {
+  return Error("Did not complete within %zu cycles", ErrorReason::TOO_MANY_CYCLES, max_cycles);
+}
+
+Error Error::InfiniteLoop(size_t cycle, size_t period) {
+  return Error("Infinite loop detected at cycle %zu, period %zu", ErrorReason::INFINITE_LOOP, cycle, period);
+}
+
+Error::operator std::string() const {
+  std::string formatted = text;
+  if (message) {
+    const int size = std::snprintf(nullptr, 0, message, args[0], args[1]);
+    formatted.resize(size);
+    std::snprintf(&formatted[0], size + 1, message, args[0], args[1]);
+  }
+  if (line) {
+    const char *position = " at line %zu, column %zu";
+    const int size = std::snprintf(nullptr, 0, position, line, column);
+    const size_t start = formatted.size();
+    formatted.resize(start + size);
+    std::snprintf(&formatted[start], size + 1, position, line, column);
+  }
+  return formatted;
+}
+
+Error Error::in_square(size_t y, size_t x) const {
+  Error error(*this);
+  error.y = y;
+  error.x = x;
+  return error;
+}
+
+Error Error::at(size_t line, size_t column) const {
+  Error error(*this);
+  error.line = line + y;
+  error.column = column + x;
+  error.y = error.x = 0;
+  return error;
+}
+
+bool Error::operator==(const Error &oth) const {
+  if (message && oth.message) {
+    return !std::strcmp(message, oth.message) && args == oth.args && line == oth.line && column == oth.column &&
+      y == oth.y && x == oth.x;
+  }
+  return std::string(*this) == std::string(oth);
+}
 
 Color::Color(char c) {
   switch (c) {
@@ -257,10 +309,10 @@ Cell Cell::OffsetCell(Direction direction) {
   c.offset = true;
   c.direction = direction;
   switch (direction) {
-  case Direction_::LEFT: c.partner_delta = {0, 1}; break;
-  case Direction_::DOWN: c.partner_delta = {-1, 0}; break;
-  case Direction_::RIGHT: c.partner_delta = {0, -1}; break;
-  case Direction_::UP: c.partner_delta = {1, 0}; break;
+  case Direction_::LEFT: c.partner = Direction_::RIGHT; break;
+  case Direction_::DOWN: c.partner = Direction_::UP; break;
+  case Direction_::RIGHT: c.partner = Direction_::LEFT; break;
+  case Direction_::UP: c.partner = Direction_::DOWN; break;
   default: break;
   }
   return c;
@@ -273,20 +325,20 @@ std::pair<Cell, Cell> Cell::Diode(Direction direction) {
   dest.direction = direction;
   switch (direction) {
   case Direction_::LEFT:
-    src.partner_delta = {0, -1};
-    dest.partner_delta = {0, 1};
+    src.partner = Direction_::LEFT;
+    dest.partner = Direction_::RIGHT;
     break;
   case Direction_::DOWN:
-    src.partner_delta = {1, 0};
-    dest.partner_delta = {-1, 0};
+    src.partner = Direction_::DOWN;
+    dest.partner = Direction_::UP;
     break;
   case Direction_::RIGHT:
-    src.partner_delta = {0, 1};
-    dest.partner_delta = {0, -1};
+    src.partner = Direction_::RIGHT;
+    dest.partner = Direction_::LEFT;
     break;
   case Direction_::UP:
-    src.partner_delta = {-1, 0};
-    dest.partner_delta = {1, 0};
+    src.partner = Direction_::UP;
+    dest.partner = Direction_::DOWN;
     break;
   default: break;
   }
@@ -470,12 +522,28 @@ Operation::operator char() const {
 Board::Board(size_t m, size_t n, size_t nbots) :
     m(m), n(n), nbots(nbots),
     level(m, n),
-    initial_cells(m, n),
+    initial_cells(m, n, RANGE),
     trespassable(m, n),
     directions(nbots, {m, n}),
     operations(nbots, {m, n}),
+    programs(nbots, {m, n}),
+    reachable(m, n),
     bots(nbots),
-    cells(m, n) {}
+    cells(m, n, RANGE),
+    dirty(m, n, RANGE),
+    constant(m, n, RANGE),
+    influences(m, n, RANGE),
+    signatures(m, n, RANGE),
+    planes(m),
+    loop_checkpoint(m, n),
+    workspace(m, n) {
+  changed.reserve(m * n);
+  reachable.reset(false);
+  constant.reset(false);
+  signatures.reset(0);
+  mark_all_dirty();
+  set_resolve_cache_size(DEFAULT_RESOLVE_CACHE_SIZE);
+}
 
 bool Board::add_input(size_t y, size_t x) {
   if (y >= m || x >= n) {
@@ -533,34 +601,30 @@ bool Board::set_output_colors(const std::vector<std::string> &colors) {
   return false;
 }
 
-bool Board::set_level(const std::string &grid_fixed) {
-  std::stringstream ss(grid_fixed);
-  std::string line;
+bool Board::set_level(std::string_view grid_fixed) {
   for (size_t y=0; y<m; ++y) {
-    std::getline(ss, line);
+    const std::string_view line = next_line(grid_fixed);
     if (line.size() != n) {
-      error = Error::BoardSizeMismatch;
+      error = Error::BoardSizeMismatch.in_square(y, std::min(line.size(), n));
       return true;
     }
     for (size_t x=0; x<n; ++x) {
-      level.at(y, x) = line[x];
+      level.at(y, x) = grid_char(line[x]);
     }
   }
   return false;
 }
 
-bool Board::set_cells(const std::string &grid_cells) {
+bool Board::set_cells(std::string_view grid_cells) {
   initial_cells.reset();
-  std::stringstream ss(grid_cells);
-  std::string line;
   for (size_t y=0; y<m; ++y) {
-    std::getline(ss, line);
+    const std::string_view line = next_line(grid_cells);
     if (line.size() != n) {
-      error = Error::BoardSizeMismatch;
+      error = Error::BoardSizeMismatch.in_square(y, std::min(line.size(), n));
       return true;
     }
     for (size_t x=0; x<n; ++x) {
-      char c = line[x];
+      char c = grid_char(line[x]);
       // specially set multi-square cells
       switch (c) {
       case '<':
@@ -584,28 +648,57 @@ bool Board::set_cells(const std::string &grid_cells) {
   // check for multi-square consistency
   for (size_t y=0; y<m; ++y) {
     for (size_t x=0; x<n; ++x) {
-      if (initial_cells.at(y, x).partner_delta) {
+      if (initial_cells.at(y, x).partner_delta()) {
         const Cell* partner = initial_cells.partner(Location(y, x));
-        if (!partner || initial_cells.at(y, x).partner_delta != -partner->partner_delta) {
-          return error = Error::InvalidInput;
+        if (!partner || initial_cells.at(y, x).partner_delta() != -partner->partner_delta()) {
+          return error = Error::InvalidInput.in_square(y, x);
         }
       }
     }
   }
-  if (ss.peek() != EOF) return error = Error::BoardSizeMismatch;
+  if (!grid_cells.empty()) return error = Error::BoardSizeMismatch.in_square(m, 0);
   return false;
 }
 
-bool Board::set_instructions(size_t k, const std::string &grid_directions, const std::string &grid_operations) {
+bool Board::set_directions(size_t k, std::string_view grid_directions) {
   if (k >= nbots) {
     error = Error::OutOfRange;
     return true;
   }
-  bool invalid = false;
-  invalid |= directions[k].reset(grid_directions);
-  invalid |= operations[k].reset(grid_operations);
-  if (invalid) error = Error::BoardSizeMismatch;
-  return invalid;
+  Location mismatch;
+  if (directions[k].reset(grid_directions, &mismatch)) {
+    error = Error::BoardSizeMismatch.in_square(mismatch.y, mismatch.x);
+    return true;
+  }
+  compile_program(k);
+  return false;
+}
+
+bool Board::set_operations(size_t k, std::string_view grid_operations) {
+  if (k >= nbots) {
+    error = Error::OutOfRange;
+    return true;
+  }
+  Location mismatch;
+  if (operations[k].reset(grid_operations, &mismatch)) {
+    error = Error::BoardSizeMismatch.in_square(mismatch.y, mismatch.x);
+    return true;
+  }
+  compile_program(k);
+  return false;
+}
+
+bool Board::set_instructions(size_t k, std::string_view grid_directions, std::string_view grid_operations) {
+  return set_directions(k, grid_directions) || set_operations(k, grid_operations);
+}
+
+bool Board::set_error(const Error &error) {
+  this->error = error;
+  return true;
+}
+
+void Board::set_error_position(size_t line, size_t column) {
+  error = error.at(line, column);
 }
 
 bool Board::validate_level() {
@@ -637,23 +730,69 @@ bool Board::validate_level() {
   return false;
 }
 
+void Board::compile_program(size_t k) {
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      ProgramStep &program_step = programs[k].at(y, x);
+      const Direction direction = directions[k].at(y, x);
+      program_step.operation = operations[k].at(y, x);
+      program_step.stops = 0;
+      for (const Direction_ incoming : {Direction_::NONE, Direction_::LEFT, Direction_::DOWN, Direction_::RIGHT,
+          Direction_::UP}) {
+        const int d = static_cast<int>(incoming);
+        program_step.moving[d] = direction ? direction : Direction(incoming);
+        const Location dest = Location(y, x) + Location(incoming);
+        if (!trespassable.valid(dest) || !trespassable.at(dest)) program_step.stops |= 1 << d;
+      }
+    }
+  }
+}
+
+void Board::compile_programs() {
+  for (size_t k=0; k<nbots; ++k) compile_program(k);
+}
+
 bool Board::reset_and_validate(bool reset_test_case) {
   error = Error();
   last_color = Color();
-  if (validate_level()) return error = Error::InvalidLevelFormat;
+  const bool invalid = validate_level();
+  // the programs stay the same from one test case to the next, and are compiled even for an invalid level so that
+  // get_paths shows them
+  if (reset_test_case) compile_programs();
+  if (invalid) return error = Error::InvalidLevelFormat;
+  if (reset_test_case) find_reachable();
   for (auto &bot : bots) bot = Bot();
   // reset state
   cells = initial_cells;
+  mark_all_dirty();
   step = 0;
   if (reset_test_case) {
     test_case = 0;
     cycle = 0;
+    clear_journal();
   }
   for (const Input &input : inputs) {
     Cell &input_cell = cells.at(input.location);
     if (input_cell != 'x' && input_cell != '+') return error = Error::InvalidInput;
     input_cell.latched = true;
   }
+  find_constants();
+  loop_checkpoint.valid = false;
+  // make room for the checkpoints taken while running
+  loop_checkpoint.bots.reserve(nbots);
+  loop_checkpoint.powers.reserve(outputs.size());
+  if (simulating_lanes) {
+    for (size_t y=0; y<m; ++y) {
+      for (size_t x=0; x<n; ++x) {
+        lane_values[cells.square(Location(y, x))] = Cell::Value(cells.at(y, x).value);
+      }
+    }
+  }
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      set_influences(Location(y, x));
+    }
+  }
   // validate cells
   for (size_t y=0; y<m; ++y) {
     for (size_t x=0; x<n; ++x) {
@@ -687,23 +826,23 @@ bool Board::reset_and_validate(bool reset_test_case) {
         case '>':
         case '^':
           if (!partner || *partner != 'x') return error = Error::InvalidInput;
-          if (!partner || cell.partner_delta != -partner->partner_delta) return error = Error::InvalidInput;
+          if (!partner || cell.partner_delta() != -partner->partner_delta()) return error = Error::InvalidInput;
           if (!partner || cell.direction != partner->direction) return error = Error::InvalidInput;
           break;
         case '[':
-          if (!partner || cell.partner_delta != -partner->partner_delta) return error = Error::InvalidInput;
+          if (!partner || cell.partner_delta() != -partner->partner_delta()) return error = Error::InvalidInput;
           if (!partner || *partner != ']') return error = Error::InvalidInput;
           break;
         case ']':
-          if (!partner || cell.partner_delta != -partner->partner_delta) return error = Error::InvalidInput;
+          if (!partner || cell.partner_delta() != -partner->partner_delta()) return error = Error::InvalidInput;
           if (!partner || *partner != '[') return error = Error::InvalidInput;
           break;
         case 'W':
-          if (!partner || cell.partner_delta != -partner->partner_delta) return error = Error::InvalidInput;
+          if (!partner || cell.partner_delta() != -partner->partner_delta()) return error = Error::InvalidInput;
           if (!partner || *partner != 'M') return error = Error::InvalidInput;
           break;
         case 'M':
-          if (!partner || cell.partner_delta != -partner->partner_delta) return error = Error::InvalidInput;
+          if (!partner || cell.partner_delta() != -partner->partner_delta()) return error = Error::InvalidInput;
           if (!partner || *partner != 'W') return error = Error::InvalidInput;
           break;
         default:
@@ -742,18 +881,20 @@ bool Board::reset_and_validate(bool reset_test_case) {
   return false;
 }
 
-bool Board::move() {
+bool Board::simulate_move() {
   if (check_status() != Status::RUNNING) return false;
+  if (simulating_lanes) sync_lanes();
   bool next = false;
   was_next = false;
   size_t syncing = 0;
   // toggle states
   for (size_t k=0; k<nbots; ++k) {
     auto &bot = bots[k];
-    const auto &direction = directions[k].at(bot.location);
-    const auto &operation = operations[k].at(bot.location);
+    const ProgramStep &program_step = programs[k].at(bot.location);
+    const Operation &operation = program_step.operation;
+    journal_cell(bot.location);
     auto &cell = cells.at(bot.location);
-    if (direction) bot.moving = direction;
+    bot.moving = program_step.next(bot.moving);
     switch (operation.type) {
     case Operation::Type::SWAP:
       if (cell.is_grabbable()) {
@@ -814,112 +955,131 @@ bool Board::move() {
   // set cell movement
   for (size_t k=0; k<nbots; ++k) {
     const auto &bot = bots[k];
-    const auto &operation = operations[k].at(bot.location);
+    const ProgramStep &program_step = programs[k].at(bot.location);
     auto &cell = cells.at(bot.location);
-    Location dest = bot.location + Location(bot.moving);
     if (bot.holding) {
-      if (operation.type == Operation::Type::SYNC && syncing <= 1) {
+      if (program_step.operation.type == Operation::Type::SYNC && syncing <= 1) {
         cell.moving = Direction_::NONE;
       } else if (bot.rotating) {
         cell.moving = Direction_::NONE;
-      } else if (!trespassable.valid(dest) || !trespassable.at(dest)) {
+      } else if (program_step.stops_moving(bot.moving)) {
         // stops at boundary
-        cell.moving = false;
+        cell.moving = Direction_::NONE;
       } else {
         cell.moving = bot.moving;
       }
     }
   }
-  // check cell collisions
-  for (const auto &bot : bots) {
+  // check cell collisions, where the held cells first claim their destinations
+  Grid<uint8_t> &claims = workspace->claims;
+  for (size_t k=0; k<nbots; ++k) {
+    const auto &bot = bots[k];
+    const Cell &cell = cells.at(bot.location);
+    if (bot.holding && cell.moving != Direction_::NONE && !programs[k].at(bot.location).stops_moving(cell.moving)) {
+      ++claims.at(bot.location + Location(cell.moving));
+    }
+  }
+  const char *collision = nullptr;
+  for (size_t k=0; k<nbots && !collision; ++k) {
+    const auto &bot = bots[k];
     const Cell &cell = cells.at(bot.location);
-    if (bot.holding && cell.moving) {
+    if (bot.holding && cell.moving != Direction_::NONE) {
       Location dest = bot.location + Location(cell.moving);
-      if (!trespassable.valid(dest) || !trespassable.at(dest)) {
+      if (programs[k].at(bot.location).stops_moving(cell.moving)) {
         // will not activate since we stop at boundary instead
-        return error = Error("Collided with boundary");
-      }
-      Cell &next_cell = cells.at(dest);
-      if (next_cell) {
-        if (next_cell.moving != cell.moving) {
-          // collided with cell
-          return error = Error("Cells collided");
-        }
-      }
-      for (const auto& oth_bot : bots) {
-        if (&oth_bot != &bot && oth_bot.holding) {
-          const Cell &oth_cell = cells.at(oth_bot.location);
-          if (oth_cell.moving) {
-            Location oth_dest = oth_bot.location + Location(oth_cell.moving);
-            if (oth_dest == dest) {
-              return error = Error("Cells collided");
-            }
-          }
-        }
+        collision = "Collided with boundary";
+      } else if (cells.at(dest) && cells.at(dest).moving != cell.moving) {
+        // collided with cell
+        collision = "Cells collided";
+      } else if (claims.at(dest) > 1) {
+        // collided with a cell held by another bot
+        collision = "Cells collided";
       }
     }
   }
+  for (size_t k=0; k<nbots; ++k) {
+    const auto &bot = bots[k];
+    const Cell &cell = cells.at(bot.location);
+    if (bot.holding && cell.moving != Direction_::NONE && !programs[k].at(bot.location).stops_moving(cell.moving)) {
+      claims.at(bot.location + Location(cell.moving)) = 0;
+    }
+  }
+  if (collision) return error = Error(collision);
   // move cells
   for (size_t k=0; k<nbots; ++k) {
-    // NB: move doesn't call itself so we can use static variables
-    static std::stack<Location> st;
-    while (!st.empty()) st.pop();
+    std::vector<Location> &st = workspace->moving;
+    st.clear();
     auto &bot = bots[k];
-    st.push(bot.location);
+    st.push_back(bot.location);
     while(!st.empty()) {
-      Location location = st.top();
+      Location location = st.back();
       Cell &cell = cells.at(location);
       if (cell.rotating) {
-        cell.value = -cell.value;
+        journal_cell(location);
+        cell.value = -Cell::Value(cell.value);
+        if (simulating_lanes) lane_values[cells.square(location)] = -lane_values[cells.square(location)];
         cell.rotating = false;
+        mark_dirty(location);
       }
-      if (cell.moving) {
+      if (cell.moving != Direction_::NONE) {
         Location dest = location + Location(cell.moving);
         Cell &next_cell = cells.at(dest);
         if (next_cell) {
           // need to move the next cell first
           // (already checked that cell moves out of the way)
-          st.push(dest);
+          st.push_back(dest);
           continue;
         } else {
           // space is empty, cell can move
+          journal_cell(location);
+          journal_cell(dest);
           next_cell = cell;
           cell = Cell();
-          next_cell.moving = false;
+          if (simulating_lanes) {
+            lane_values[cells.square(dest)] = lane_values[cells.square(location)];
+            lane_values[cells.square(location)] = LaneValue();
+          }
+          next_cell.moving = Direction_::NONE;
+          mark_dirty(location);
+          mark_dirty(dest);
+          update_influences(location);
+          update_influences(dest);
         }
       }
-      st.pop();
+      st.pop_back();
     }
   }
   // move bots
   for (size_t k=0; k<nbots; ++k) {
     auto &bot = bots[k];
-    const auto &operation = operations[k].at(bot.location);
-    if (operation.type == Operation::Type::SYNC && syncing <= 1) {
+    const ProgramStep &program_step = programs[k].at(bot.location);
+    if (program_step.operation.type == Operation::Type::SYNC && syncing <= 1) {
       continue;
     } else if (bot.rotating) {
       continue;
     } else {
       // bot can move
-      Location dest = bot.location + Location(bot.moving);
-      if (!trespassable.valid(dest) || !trespassable.at(dest)) {
+      if (program_step.stops_moving(bot.moving)) {
         // stop at boundary
         continue;
         // return error = Error("Collided with boundary");
       }
-      bot.location = dest;
+      bot.location = bot.location + Location(bot.moving);
     }
   }
   // pre resolve latches and checks
   for (size_t k=0; k<nbots; ++k) {
     const auto &bot = bots[k];
-    const Operation &operation = operations[k].at(bot.location);
+    const Operation &operation = programs[k].at(bot.location).operation;
+    journal_cell(bot.location);
     Cell &cell = cells.at(bot.location);
     switch (operation.type) {
     case Operation::Type::ROTATE:
       if (!ROTATE_TAKES_TURN) {
         if (cell.is_rotateable()) {
-          cell.value = -cell.value;
+          cell.value = -Cell::Value(cell.value);
+          if (simulating_lanes) lane_values[cells.square(bot.location)] = -lane_values[cells.square(bot.location)];
+          mark_dirty(bot.location);
         }
       }
       break;
@@ -928,6 +1088,8 @@ bool Board::move() {
         if (cell.latched) {
           if (operation.value & Operation::UNLATCH.op.value)  {
             cell.latched = false;
+            mark_dirty(bot.location);
+            update_influences(bot.location);
           }
         } else {
           if (operation.value & Operation::LATCH.op.value)  {
@@ -940,6 +1102,8 @@ bool Board::move() {
       if (cell.is_refreshable() && cell.latched) {
         cell.latched = false;
         cell.refreshing = true;
+        mark_dirty(bot.location);
+        update_influences(bot.location);
       }
       break;
     case Operation::Type::POWER:
@@ -967,9 +1131,40 @@ bool Board::move() {
     if (cell.refreshing) {
       cell.latched = true;
       cell.refreshing = false;
+      mark_dirty(bot.location);
+      update_influences(bot.location);
     }
   }
-  if (next) {
+  if (next && simulating_lanes) {
+    // each lane checks the output of its own test case and stops at the end of it
+    for (uint64_t remaining=lanes; remaining; remaining&=remaining-1) {
+      const size_t lane = __builtin_ctzll(remaining);
+      const std::vector<Color> &colors = output_colors[lane_test_cases[lane]];
+      Color color = Color_::BLACK;
+      for (const auto& output : outputs) {
+        if (output.power) {
+          Cell cell = cells.at(output.location);
+          cell.value = lane_values[cells.square(output.location)].get(lane);
+          color = color + cell.operator Color();
+        }
+      }
+      if (remaining == lanes) last_color = color;
+      LaneResult &result = lane_results[lane];
+      if (color == Color_::INVALID) {
+        result.error = Error("Output is in undetermined state", ErrorReason::WRONG_OUTPUT);
+      } else if (color != colors[step]) {
+        result.error = Error("Wrong output", ErrorReason::WRONG_OUTPUT);
+      } else if (step + 1 >= colors.size()) {
+        result.passed = true;
+      } else {
+        continue;
+      }
+      result.cycles = result.passed ? cycle + 1 : cycle;
+      lanes &= ~(uint64_t(1) << lane);
+    }
+    ++step;
+    was_next = true;
+  } else if (next) {
     last_color = Color_::BLACK;
     for (const auto& output : outputs) {
       if (output.power) {
@@ -986,6 +1181,10 @@ bool Board::move() {
     ++step;
     if (step >= output_colors[test_case].size() && test_case < output_colors.size() - 1) {
       ++test_case;
+      // the next test case starts over from the initial cells
+      for (size_t y=0; y<m; ++y) {
+        for (size_t x=0; x<n; ++x) journal_cell(Location(y, x));
+      }
       reset_and_validate(false);
     } else {
       was_next = true;
@@ -995,6 +1194,87 @@ bool Board::move() {
   return false;
 }
 
+void Board::mark_dirty(Square square) {
+  if (dirty.at(square)) return;
+  dirty.at(square) = true;
+  changed.push_back(square);
+}
+
+void Board::mark_all_dirty() {
+  dirty.reset(false);
+  changed.clear();
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      mark_dirty(Location(y, x));
+    }
+  }
+}
+
+void Board::find_reachable() {
+  reachable.reset(false);
+  for (const Grid<uint8_t> &path : get_paths()) {
+    for (size_t y=0; y<m; ++y) {
+      for (size_t x=0; x<n; ++x) {
+        reachable.at(y, x) |= path.at(y, x) != 0;
+      }
+    }
+  }
+}
+
+void Board::find_constants() {
+  constant.reset(false);
+  if (!resolve_constants) return;
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      const Cell &cell = cells.at(y, x);
+      // only bots rotate, move, unlatch or refresh cells
+      if (!cell.latched || !cell.is_1x1()) continue;
+      constant.at(y, x) = !reachable.at(y, x);
+    }
+  }
+  // inputs are set every cycle
+  for (const Input &input : inputs) constant.at(input.location) = false;
+  // constant cells are not resolved, so give them the value they would resolve to
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      Cell &cell = cells.at(y, x);
+      if (constant.at(y, x) && cell.value == Cell::Value_::UNKNOWN) cell.value = Cell::Value_::UNDEFINED;
+    }
+  }
+}
+
+void Board::set_resolve_constants(bool use_constants) {
+  resolve_constants = use_constants;
+  find_constants();
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      set_influences(Location(y, x));
+    }
+  }
+  mark_all_dirty();
+}
+
+void Board::set_incremental_resolve(bool incremental) {
+  incremental_resolve = incremental;
+  mark_all_dirty();
+}
+
+void Board::set_resolve_threads(size_t threads, size_t min_cells) {
+  resolve_threads = threads;
+  parallel_resolve_min_cells = min_cells;
+}
+
+void Board::set_resolve_cache_size(size_t entries) {
+  size_t size = 0;
+  if (entries) for (size=1; size<entries; size<<=1);
+  resolve_cache = ResolveCache();
+  resolve_cache.entries = size;
+  resolve_cache.valid.resize(size);
+  resolve_cache.hashes.resize(size);
+  resolve_cache.signatures.resize(size * cells.squares());
+  resolve_cache.values.resize(size * cells.squares());
+}
+
 std::pair<bool, bool> Board::run(size_t max_cycles, std::ostream *os) {
   // make sure it starts resolved
   if (resolve()) {
@@ -1015,13 +1295,669 @@ std::pair<bool, bool> Board::run(size_t max_cycles, std::ostream *os) {
     case Status::DONE:
       return {true, false};
     }
+    if (detect_loops && find_loop()) {
+      this->error = get_loop_error();
+      return {false, false};
+    }
   }
-  error = Error(Formatter() << "Did not complete within " << max_cycles << " cycles", ErrorReason::TOO_MANY_CYCLES);
+  error = Error::TooManyCycles(max_cycles);
   return {false, false};
 }
 
+std::pair<bool, bool> Board::run_parallel(size_t max_cycles, size_t threads) {
+  // the journal records the moves in order
+  if (check_status() != Status::RUNNING || journal.recording) return run(max_cycles);
+  // How the run of a test case on its own ended, as seen by run
+  enum class Outcome {
+    NEXT_TEST_CASE,
+    PASSED,
+    FAILED,
+    ERROR,
+    TOO_MANY_CYCLES,
+  };
+  struct TestCaseRun {
+    std::unique_ptr<Board> board;
+    Outcome outcome = Outcome::TOO_MANY_CYCLES;
+    size_t moves = 0;
+  };
+  const size_t first_test_case = test_case;
+  const size_t ntest_cases = output_colors.size() - first_test_case;
+  // run test case first_test_case + k for at most max_moves moves, continuing this board for the first
+  const auto run_test_case = [&](size_t k, size_t max_moves) {
+    TestCaseRun run;
+    run.board.reset(new Board(*this));
+    Board &board = *run.board;
+    if (!k) {
+      // start resolved like run
+      if (board.resolve()) {
+        run.outcome = Outcome::ERROR;
+        return run;
+      }
+    } else {
+      // start the test case the way move moves on to it
+      board.test_case = first_test_case + k;
+      board.cycle = 0;
+      board.reset_and_validate(false);
+      if (board.check_status() == Status::INVALID) {
+        run.outcome = Outcome::FAILED;
+        return run;
+      }
+      if (board.detect_loops) board.find_loop();
+    }
+    while (run.moves < max_moves) {
+      ++run.moves;
+      if (board.move()) {
+        run.outcome = Outcome::ERROR;
+        return run;
+      }
+      if (board.test_case != first_test_case + k) {
+        run.outcome = Outcome::NEXT_TEST_CASE;
+        return run;
+      }
+      switch (board.check_status()) {
+      case Status::INVALID:
+        run.outcome = Outcome::FAILED;
+        return run;
+      case Status::RUNNING:
+        break;
+      case Status::DONE:
+        run.outcome = Outcome::PASSED;
+        return run;
+      }
+      if (board.detect_loops && board.find_loop()) {
+        board.error = board.get_loop_error();
+        run.outcome = Outcome::FAILED;
+        return run;
+      }
+    }
+    return run;
+  };
+
+  std::vector<TestCaseRun> runs(ntest_cases);
+  // test cases after one that ends the run are not needed
+  std::atomic<size_t> last_needed{ntest_cases};
+  const auto job = [&](size_t worker, size_t k) {
+    if (k > last_needed) return;
+    runs[k] = run_test_case(k, max_cycles);
+    if (runs[k].outcome == Outcome::NEXT_TEST_CASE) return;
+    for (size_t last = last_needed; k < last && !last_needed.compare_exchange_weak(last, k); ) {}
+  };
+  const size_t nworkers = std::min(threads, ntest_cases);
+  if (nworkers > 1) {
+    WorkerPool(nworkers).run(ntest_cases, job);
+  } else {
+    for (size_t k=0; k<ntest_cases; ++k) job(0, k);
+  }
+
+  // replay the outcomes in order
+  const size_t first_cycle = cycle;
+  size_t moves = 0;
+  for (size_t k=0; ; ++k) {
+    TestCaseRun &run = runs[k];
+    if (run.outcome == Outcome::TOO_MANY_CYCLES || moves + run.moves > max_cycles) {
+      // stop where run runs out of cycles
+      run = run_test_case(k, max_cycles - moves);
+      run.board->error = Error::TooManyCycles(max_cycles);
+    }
+    if (run.outcome == Outcome::NEXT_TEST_CASE) {
+      moves += run.moves;
+      continue;
+    }
+    Board &board = *run.board;
+    if (k) {
+      // cycles of the earlier test cases
+      const size_t offset = first_cycle + moves;
+      board.cycle += offset;
+      board.loop_checkpoint.cycle += offset;
+      if (board.get_error_reason() == ErrorReason::INFINITE_LOOP) board.error = board.get_loop_error();
+    }
+    take_state(board);
+    return {run.outcome == Outcome::PASSED, run.outcome == Outcome::ERROR};
+  }
+}
+
+void Board::take_state(Board &board) {
+  error = board.error;
+  last_color = board.last_color;
+  bots = board.bots;
+  outputs = board.outputs;
+  cells = std::move(board.cells);
+  was_next = board.was_next;
+  test_case = board.test_case;
+  step = board.step;
+  cycle = board.cycle;
+  dirty = std::move(board.dirty);
+  changed = std::move(board.changed);
+  constant = std::move(board.constant);
+  influences = std::move(board.influences);
+  signatures = std::move(board.signatures);
+  signature_hash = board.signature_hash;
+  planes = std::move(board.planes);
+  loop_checkpoint = std::move(board.loop_checkpoint);
+}
+
+// Combine a hash with a value
+static uint64_t mix(uint64_t hash, uint64_t value) {
+  hash = (hash ^ value) * 0x9e3779b97f4a7c15;
+  return hash ^ (hash >> 29);
+}
+
+// Whether two cells are in the same state for the following cycles
+// Previous values are overwritten before they are used, and values are compared separately in lanes.
+static bool same_state(const Cell &a, const Cell &b, bool values) {
+  return a.exists == b.exists && a.x == b.x && a.latched == b.latched && a.offset == b.offset &&
+    a.direction == b.direction && a.partner == b.partner && (!values || a.value == b.value) &&
+    a.moving == b.moving && a.held == b.held && a.rotating == b.rotating && a.refreshing == b.refreshing;
+}
+
+uint64_t Board::get_state_hash() const {
+  uint64_t hash = mix(0, step);
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      const Cell &cell = cells.at(y, x);
+      if (!cell) continue;
+      hash = mix(hash, y * n + x);
+      hash = mix(hash, cell.x | cell.latched << 1 | cell.held << 2 | cell.rotating << 3 | cell.refreshing << 4 |
+        static_cast<uint64_t>(static_cast<Direction_>(cell.moving)) << 5 |
+        static_cast<uint64_t>(simulating_lanes ? 0 : static_cast<uint8_t>(static_cast<Cell::Value_>(cell.value))) << 8);
+    }
+  }
+  for (const Bot &bot : bots) {
+    hash = mix(hash, bot.location.y * n + bot.location.x);
+    hash = mix(hash, bot.holding | bot.rotating << 1 | static_cast<uint64_t>(static_cast<Direction_>(bot.moving)) << 2);
+  }
+  for (const Output &output : outputs) hash = mix(hash, output.power);
+  return hash;
+}
+
+Error Board::get_loop_error() const {
+  return Error::InfiniteLoop(cycle, cycle - loop_checkpoint.cycle);
+}
+
+uint64_t Board::find_loop() {
+  LoopCheckpoint &checkpoint = loop_checkpoint;
+  uint64_t looping = 0;
+  // the bots rarely match outside of loops, so the cells are only hashed and compared when they do
+  if (checkpoint.valid && checkpoint.step == step && checkpoint.bots == bots) {
+    looping = simulating_lanes ? lanes : 1;
+    for (size_t i=0; i<outputs.size(); ++i) {
+      if (outputs[i].power != checkpoint.powers[i]) looping = 0;
+    }
+    if (looping && get_state_hash() != checkpoint.hash) looping = 0;
+    for (size_t y=0; y<m && looping; ++y) {
+      for (size_t x=0; x<n; ++x) {
+        if (!same_state(cells.at(y, x), checkpoint.cells.at(y, x), !simulating_lanes)) {
+          looping = 0;
+          break;
+        }
+      }
+    }
+    if (simulating_lanes && looping) {
+      for (size_t i=0; i<lane_values.size(); ++i) looping &= ~lane_values[i].differ(checkpoint.lane_values[i]);
+    }
+  }
+  if (looping) return looping;
+  if (!checkpoint.valid || cycle - checkpoint.cycle == checkpoint.power) {
+    checkpoint.power = checkpoint.valid ? 2 * checkpoint.power : 1;
+    checkpoint.valid = true;
+    checkpoint.cycle = cycle;
+    checkpoint.hash = get_state_hash();
+    checkpoint.step = step;
+    checkpoint.cells = cells;
+    checkpoint.bots = bots;
+    checkpoint.powers.clear();
+    for (const Output &output : outputs) checkpoint.powers.push_back(output.power);
+    if (simulating_lanes) checkpoint.lane_values = lane_values;
+  }
+  return 0;
+}
+
+bool Board::start_lanes(size_t first_test_case, size_t nlanes) {
+  simulating_lanes = true;
+  lanes = 0;
+  lane_test_cases.assign(LANES, 0);
+  lane_results.assign(LANES, LaneResult());
+  for (size_t lane=0; lane<nlanes; ++lane) {
+    lane_test_cases[lane] = first_test_case + lane;
+    if (output_colors[first_test_case + lane].empty()) lane_results[lane].passed = true;
+    else lanes |= uint64_t(1) << lane;
+  }
+  lane_values.assign(cells.squares(), LaneValue());
+  lane_previous_values.assign(cells.squares(), LaneValue());
+  // the lanes resolve different values every cycle
+  set_resolve_cache_size(0);
+  journal.recording = false;
+  return reset_and_validate(true);
+}
+
+uint64_t Board::get_branching_lanes() const {
+  if (!lanes) return 0;
+  const size_t first_lane = __builtin_ctzll(lanes);
+  uint64_t same = lanes;
+  for (size_t k=0; k<nbots; ++k) {
+    const auto &bot = bots[k];
+    const Operation &operation = programs[k].at(bot.location).operation;
+    const Cell &cell = cells.at(bot.location);
+    if (operation.type != Operation::Type::BRANCH || !cell) continue;
+    // as in move
+    const LaneValue &value = lane_values[cells.square(bot.location)];
+    const uint64_t one = value.is(Cell::Value_::ONE);
+    const uint64_t zero = value.is(Cell::Value_::ZERO);
+    const int shift = 2 * !cell.x;
+    const uint64_t taken = (operation.value & (0b01 << shift) ? one : 0) | (operation.value & (0b10 << shift) ? zero : 0);
+    const uint64_t failed = operation.value & (0b11 << shift) ? ~(one | zero) : 0;
+    same &= ~(taken ^ -(taken >> first_lane & 1)) & ~(failed ^ -(failed >> first_lane & 1));
+  }
+  return same;
+}
+
+void Board::sync_lanes() {
+  if (!lanes) return;
+  const size_t first_lane = __builtin_ctzll(lanes);
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      cells.at(y, x).value = lane_values[cells.square(Location(y, x))].get(first_lane);
+    }
+  }
+}
+
+std::vector<LaneResult> Board::run_lanes(size_t max_cycles) const {
+  std::vector<LaneResult> results(output_colors.size());
+  std::vector<Board> groups;
+  for (size_t first_test_case=0; first_test_case<results.size(); first_test_case+=LANES) {
+    const size_t nlanes = std::min(LANES, results.size() - first_test_case);
+    groups.push_back(*this);
+    // start resolved like run
+    if (!groups.back().start_lanes(first_test_case, nlanes)) groups.back().resolve();
+    // test cases without steps pass right away
+    for (size_t lane=0; lane<nlanes; ++lane) {
+      if (!(groups.back().lanes >> lane & 1)) results[first_test_case + lane] = groups.back().lane_results[lane];
+    }
+    while (!groups.empty()) {
+      Board &group = groups.back();
+      const uint64_t running = group.lanes;
+      if (running && !group.error && group.cycle < max_cycles) {
+        const uint64_t branching = group.get_branching_lanes();
+        if (branching != running) {
+          // lanes that branch differently from the first lane continue separately
+          Board split(group);
+          split.lanes &= ~branching;
+          group.lanes = branching;
+          groups.push_back(std::move(split));
+          continue;
+        }
+        group.move();
+        const uint64_t looping = group.detect_loops && !group.error ? group.find_loop() : 0;
+        if (looping) {
+          const Error error = group.get_loop_error();
+          for (uint64_t remaining=looping; remaining; remaining&=remaining-1) {
+            const size_t lane = __builtin_ctzll(remaining);
+            group.lane_results[lane].error = error;
+            group.lane_results[lane].cycles = group.cycle;
+          }
+          group.lanes &= ~looping;
+        }
+      }
+      // lanes stopped by an error of the whole group
+      if (group.error || group.cycle >= max_cycles) {
+        const Error error = group.error ? group.error :
+          Error::TooManyCycles(max_cycles);
+        for (uint64_t remaining=group.lanes; remaining; remaining&=remaining-1) {
+          const size_t lane = __builtin_ctzll(remaining);
+          group.lane_results[lane].error = error;
+          group.lane_results[lane].cycles = group.cycle;
+        }
+        group.lanes = 0;
+      }
+      for (uint64_t stopped=running & ~group.lanes; stopped; stopped&=stopped-1) {
+        const size_t lane = __builtin_ctzll(stopped);
+        results[group.lane_test_cases[lane]] = group.lane_results[lane];
+      }
+      if (!group.lanes) groups.pop_back();
+    }
+  }
+  return results;
+}
+
+std::vector<LaneResult> Board::run_lanes(size_t max_cycles, const std::vector<std::vector<std::string>> &bits,
+    const std::vector<std::string> &colors) const {
+  Board board(*this);
+  if (board.set_input_bits(bits) || board.set_output_colors(colors)) {
+    LaneResult result;
+    result.error = board.error;
+    return std::vector<LaneResult>(colors.size(), result);
+  }
+  return board.run_lanes(max_cycles);
+}
+
+// Snapshot layout, with fixed-size little-endian fields:
+// version, m, n, nbots, noutputs (u16), the runtime state (see put_runtime) and 3 bytes per square (see
+// pack_cell). Journal entries are the runtime state followed by the square (u32) and the 3 bytes of
+// each cell changed by the move, and journal keyframes are the runtime state followed by the 3 bytes of
+// each touched square.
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+constexpr size_t PACKED_CELL_SIZE = 3;
+
+template<typename T>
+static void put(std::vector<uint8_t> &blob, T value) {
+  for (size_t i=0; i<sizeof(T); ++i) blob.push_back(static_cast<uint64_t>(value) >> (8 * i));
+}
+
+// Read a field at offset and advance past it, returning true if the blob is too short
+template<typename T>
+static bool get(const std::vector<uint8_t> &blob, size_t &offset, T *value) {
+  if (offset + sizeof(T) > blob.size()) return true;
+  uint64_t bits = 0;
+  for (size_t i=0; i<sizeof(T); ++i) bits |= static_cast<uint64_t>(blob[offset++]) << (8 * i);
+  *value = static_cast<T>(bits);
+  return false;
+}
+
+// Flags, directions and values of a cell in PACKED_CELL_SIZE bytes
+static void pack_cell(const Cell &cell, uint8_t *packed) {
+  packed[0] = cell.exists | cell.x << 1 | cell.latched << 2 | cell.offset << 3 | cell.held << 4 |
+    cell.rotating << 5 | cell.refreshing << 6;
+  packed[1] = static_cast<uint8_t>(static_cast<Direction_>(cell.direction)) |
+    static_cast<uint8_t>(static_cast<Direction_>(cell.moving)) << 3;
+  packed[2] = static_cast<uint8_t>(static_cast<Cell::Value_>(cell.value)) |
+    static_cast<uint8_t>(static_cast<Cell::Value_>(cell.previous_value)) << 2 |
+    static_cast<uint8_t>(cell.partner) << 4;
+}
+
+static bool unpack_cell(const std::vector<uint8_t> &blob, size_t &offset, Cell *cell) {
+  uint8_t flags, directions, values;
+  if (get(blob, offset, &flags) || get(blob, offset, &directions) || get(blob, offset, &values)) return true;
+  if ((directions & 7) > 4 || (directions >> 3 & 7) > 4 || (values >> 4 & 7) > 4) return true;
+  cell->exists = flags & 1;
+  cell->x = flags >> 1 & 1;
+  cell->latched = flags >> 2 & 1;
+  cell->offset = flags >> 3 & 1;
+  cell->held = flags >> 4 & 1;
+  cell->rotating = flags >> 5 & 1;
+  cell->refreshing = flags >> 6 & 1;
+  cell->direction = static_cast<Direction_>(directions & 7);
+  cell->moving = static_cast<Direction_>(directions >> 3 & 7);
+  cell->value = static_cast<Cell::Value_>(values & 3);
+  cell->previous_value = static_cast<Cell::Value_>(values >> 2 & 3);
+  cell->partner = static_cast<Direction_>(values >> 4 & 7);
+  return false;
+}
+
+void Board::pack_cells(std::vector<uint8_t> &blob) const {
+  const size_t begin = blob.size();
+  blob.resize(begin + PACKED_CELL_SIZE * m * n);
+  for (size_t i=0; i<m*n; ++i) pack_cell(cells.at(i / n, i % n), &blob[begin + PACKED_CELL_SIZE * i]);
+}
+
+void Board::put_runtime(std::vector<uint8_t> &blob) const {
+  const std::string error_text = error;
+  put<uint32_t>(blob, test_case);
+  put<uint32_t>(blob, step);
+  put<uint32_t>(blob, cycle);
+  put<uint8_t>(blob, static_cast<uint8_t>(static_cast<Color_>(last_color)));
+  put<uint8_t>(blob, was_next);
+  put<uint8_t>(blob, static_cast<uint8_t>(error.error_reason()));
+  put<uint16_t>(blob, error_text.size());
+  blob.insert(blob.end(), error_text.begin(), error_text.end());
+  for (const Bot &bot : bots) {
+    put<int16_t>(blob, bot.location.y);
+    put<int16_t>(blob, bot.location.x);
+    put<uint8_t>(blob, bot.location.valid);
+    put<uint8_t>(blob, static_cast<uint8_t>(static_cast<Direction_>(bot.moving)));
+    put<uint8_t>(blob, bot.holding);
+    put<uint8_t>(blob, bot.rotating);
+  }
+  for (const Output &output : outputs) put<uint8_t>(blob, output.power);
+}
+
+bool Board::get_runtime(const std::vector<uint8_t> &blob, size_t &offset, bool apply) {
+  uint32_t blob_test_case, blob_step, blob_cycle;
+  uint8_t blob_last_color, blob_was_next, reason;
+  uint16_t error_size;
+  if (get(blob, offset, &blob_test_case) || get(blob, offset, &blob_step) || get(blob, offset, &blob_cycle) ||
+      get(blob, offset, &blob_last_color) || get(blob, offset, &blob_was_next) || get(blob, offset, &reason) ||
+      get(blob, offset, &error_size) || offset + error_size > blob.size()) {
+    return true;
+  }
+  if (blob_test_case >= output_colors.size() || blob_last_color > static_cast<uint8_t>(Color_::UNNAMED) ||
+      reason > static_cast<uint8_t>(ErrorReason::INFINITE_LOOP)) {
+    return true;
+  }
+  // only the last test case is left with every output step done
+  const size_t nsteps = output_colors[blob_test_case].size();
+  if (blob_step > nsteps || (blob_step == nsteps && blob_test_case != output_colors.size() - 1)) return true;
+  const std::string error_text(blob.begin() + offset, blob.begin() + offset + error_size);
+  offset += error_size;
+  std::vector<Bot> blob_bots(nbots);
+  for (Bot &bot : blob_bots) {
+    int16_t y, x;
+    uint8_t valid, moving, holding, rotating;
+    if (get(blob, offset, &y) || get(blob, offset, &x) || get(blob, offset, &valid) || get(blob, offset, &moving) ||
+        get(blob, offset, &holding) || get(blob, offset, &rotating) || moving > 4) {
+      return true;
+    }
+    if (valid) {
+      if (y < 0 || static_cast<size_t>(y) >= m || x < 0 || static_cast<size_t>(x) >= n) return true;
+      bot.location = Location(y, x);
+    }
+    bot.moving = static_cast<Direction_>(moving);
+    bot.holding = holding;
+    bot.rotating = rotating;
+  }
+  if (offset + outputs.size() > blob.size()) return true;
+  if (!apply) {
+    offset += outputs.size();
+    return false;
+  }
+  for (Output &output : outputs) {
+    output.power = blob[offset++];
+    output.toggle_power = false;
+  }
+  test_case = blob_test_case;
+  step = blob_step;
+  cycle = blob_cycle;
+  last_color = static_cast<Color_>(blob_last_color);
+  was_next = blob_was_next;
+  error = error_text.empty() ? Error() : Error(error_text, static_cast<ErrorReason>(reason));
+  bots = std::move(blob_bots);
+  return false;
+}
+
+// Whether the influences around a cell change with its state, which happens when it moves or changes latch state
+static bool same_geometry(const Cell &cell, const Cell &old_cell) {
+  return cell.exists == old_cell.exists && cell.x == old_cell.x && cell.latched == old_cell.latched &&
+    cell.offset == old_cell.offset && cell.direction == old_cell.direction &&
+    cell.partner == old_cell.partner;
+}
+
+std::vector<uint8_t> Board::snapshot() const {
+  std::vector<uint8_t> blob;
+  blob.reserve(64 + 8 * bots.size() + outputs.size() + PACKED_CELL_SIZE * m * n);
+  put<uint16_t>(blob, SNAPSHOT_VERSION);
+  put<uint16_t>(blob, m);
+  put<uint16_t>(blob, n);
+  put<uint16_t>(blob, nbots);
+  put<uint16_t>(blob, outputs.size());
+  put_runtime(blob);
+  pack_cells(blob);
+  return blob;
+}
+
+bool Board::restore(const std::vector<uint8_t> &blob) {
+  if (restore_state(blob)) return true;
+  clear_journal();
+  return false;
+}
+
+bool Board::restore_state(const std::vector<uint8_t> &blob) {
+  size_t offset = 0;
+  uint16_t version, blob_m, blob_n, blob_nbots, noutputs;
+  if (get(blob, offset, &version) || version != SNAPSHOT_VERSION) return true;
+  if (get(blob, offset, &blob_m) || get(blob, offset, &blob_n) || get(blob, offset, &blob_nbots) ||
+      get(blob, offset, &noutputs)) {
+    return true;
+  }
+  if (blob_m != m || blob_n != n || blob_nbots != nbots || noutputs != outputs.size()) return true;
+  // read everything before changing the board
+  const size_t runtime = offset;
+  if (get_runtime(blob, offset, false)) return true;
+  Grid<Cell> blob_cells(m, n, RANGE);
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      if (unpack_cell(blob, offset, &blob_cells.at(y, x))) return true;
+    }
+  }
+  if (offset != blob.size()) return true;
+  get_runtime(blob, offset = runtime, true);
+  std::swap(cells, blob_cells);
+  // derived state
+  for (size_t y=0; y<m; ++y) {
+    for (size_t x=0; x<n; ++x) {
+      if (!same_geometry(cells.at(y, x), blob_cells.at(y, x))) update_influences(Location(y, x));
+    }
+  }
+  mark_all_dirty();
+  loop_checkpoint.valid = false;
+  return false;
+}
+
+void Board::set_record_journal(bool record, size_t keyframe_interval) {
+  journal.recording = record;
+  journal.keyframe_interval = std::max<size_t>(keyframe_interval, 1);
+  clear_journal();
+}
+
+void Board::clear_journal() {
+  journal.changes.clear();
+  journal.entries.clear();
+  journal.keyframes.clear();
+  journal.frames.clear();
+}
+
+void Board::journal_cell(Square square) {
+  if (!journal.saving || journal.saved[square] == journal.move) return;
+  if (!journal.saved[square]) journal.touched.push_back(square);
+  journal.saved[square] = journal.move;
+  std::vector<uint8_t> &changes = journal.changes;
+  put<uint32_t>(changes, square);
+  changes.resize(changes.size() + PACKED_CELL_SIZE);
+  pack_cell(cells.at(square), &changes[changes.size() - PACKED_CELL_SIZE]);
+}
+
+bool Board::move() {
+  if (!journal.recording || check_status() != Status::RUNNING) return simulate_move();
+  if (journal.entries.empty()) {
+    // the keyframes hold the squares changed from here on
+    journal.base.assign(&cells.at(Square(0)), &cells.at(Square(0)) + cells.squares());
+    journal.touched.clear();
+    journal.saved.assign(cells.squares(), 0);
+    journal.move = 0;
+  }
+  if (++journal.move == 0) {
+    // keep the touched squares apart from the moves to come
+    for (uint32_t &saved : journal.saved) saved = saved != 0;
+    journal.move = 2;
+  }
+  put_runtime(journal.changes);
+  journal.saving = true;
+  const bool result = simulate_move();
+  journal.saving = false;
+  journal.entries.push_back(journal.changes.size());
+  if (journal.entries.size() % journal.keyframe_interval == 0) {
+    std::vector<uint8_t> &frames = journal.frames;
+    journal.keyframes.push_back({journal.entries.size(), cycle, journal.touched.size(), frames.size()});
+    put_runtime(frames);
+    const size_t begin = frames.size();
+    frames.resize(begin + PACKED_CELL_SIZE * journal.touched.size());
+    for (size_t i=0; i<journal.touched.size(); ++i) {
+      pack_cell(cells.at(journal.touched[i]), &frames[begin + PACKED_CELL_SIZE * i]);
+    }
+  }
+  return result;
+}
+
+void Board::undo_entry(std::vector<Location> &moved) {
+  const size_t end = journal.entries.back();
+  journal.entries.pop_back();
+  const size_t begin = journal.entries.empty() ? 0 : journal.entries.back();
+  size_t offset = begin;
+  get_runtime(journal.changes, offset, true);
+  while (offset < end) {
+    uint32_t square = 0;
+    Cell cell;
+    get(journal.changes, offset, &square);
+    unpack_cell(journal.changes, offset, &cell);
+    if (!same_geometry(cell, cells.at(square))) moved.push_back(cells.location(square));
+    cells.at(square) = cell;
+  }
+  journal.changes.resize(begin);
+  while (!journal.keyframes.empty() && journal.keyframes.back().entries > journal.entries.size()) {
+    journal.frames.resize(journal.keyframes.back().begin);
+    journal.keyframes.pop_back();
+  }
+}
+
+void Board::restore_keyframe(size_t k, std::vector<Location> &moved) {
+  const Journal::Keyframe &keyframe = journal.keyframes[k];
+  const auto restore_cell = [&](Square square, const Cell &cell) {
+    if (!same_geometry(cell, cells.at(square))) moved.push_back(cells.location(square));
+    cells.at(square) = cell;
+  };
+  // squares first changed after the keyframe go back to the base
+  for (size_t i=keyframe.touched; i<journal.touched.size(); ++i) {
+    const Square square = journal.touched[i];
+    restore_cell(square, journal.base[square]);
+    journal.saved[square] = 0;
+  }
+  journal.touched.resize(keyframe.touched);
+  size_t offset = keyframe.begin;
+  get_runtime(journal.frames, offset, true);
+  for (const Square square : journal.touched) {
+    Cell cell;
+    unpack_cell(journal.frames, offset, &cell);
+    restore_cell(square, cell);
+  }
+  journal.entries.resize(keyframe.entries);
+  journal.changes.resize(journal.entries.empty() ? 0 : journal.entries.back());
+  journal.keyframes.resize(k + 1);
+  journal.frames.resize(offset);
+}
+
+bool Board::step_back() {
+  if (journal.entries.empty()) return true;
+  std::vector<Location> moved;
+  undo_entry(moved);
+  for (const Location &location : moved) update_influences(location);
+  mark_all_dirty();
+  loop_checkpoint.valid = false;
+  return false;
+}
+
+bool Board::seek(size_t target_cycle) {
+  if (target_cycle > cycle) return true;
+  // the journal starts with the runtime state of the earliest recorded cycle
+  uint32_t earliest_cycle = cycle;
+  size_t offset = 2 * sizeof(uint32_t);
+  if (!journal.entries.empty()) get(journal.changes, offset, &earliest_cycle);
+  if (target_cycle < earliest_cycle) return true;
+  std::vector<Location> moved;
+  // jump to the first keyframe from the target on
+  for (size_t k=0; k<journal.keyframes.size(); ++k) {
+    const Journal::Keyframe &keyframe = journal.keyframes[k];
+    if (keyframe.cycle < target_cycle) continue;
+    if (keyframe.entries < journal.entries.size()) restore_keyframe(k, moved);
+    break;
+  }
+  while (cycle > target_cycle && !journal.entries.empty()) undo_entry(moved);
+  for (const Location &location : moved) update_influences(location);
+  mark_all_dirty();
+  loop_checkpoint.valid = false;
+  return cycle != target_cycle;
+}
+
 Status Board::check_status() const {
   if (error) return Status::INVALID;
+  if (simulating_lanes) return lanes ? Status::RUNNING : Status::DONE;
   if (test_case == output_colors.size() - 1 && step >= output_colors.back().size()) return Status::DONE;
   return Status::RUNNING;
 }
@@ -1061,7 +1997,7 @@ int Board::get_num_cells() const {
   for (const auto &row : cells) {
     for (const auto &cell : row) {
       if (cell.exists) {
-        if (cell.is_1x1() || cell.partner_delta.y > 0 || cell.partner_delta.x > 0) {
+        if (cell.is_1x1() || cell.partner_delta().y > 0 || cell.partner_delta().x > 0) {
           ++symbols;
         }
       }
@@ -1169,7 +2105,7 @@ std::vector<Grid<uint8_t>> Board::get_paths() const {
     std::set<Bot> done;
     std::queue<Bot> que;
     for (int y=0; y<static_cast<int>(m); ++y) for (int x=0; x<static_cast<int>(n); ++x) {
-      if (operations[k][y][x].type == Operation::Type::START) {
+      if (programs[k][y][x].operation.type == Operation::Type::START) {
         Bot bot({y, x});
         bot.moving = Direction_::NONE;
         done.insert(bot);
@@ -1179,11 +2115,10 @@ std::vector<Grid<uint8_t>> Board::get_paths() const {
     while (!que.empty()) {
       Bot bot = que.front();
       que.pop();
-      const Operation &op = operations[k].at(bot.location);
+      const ProgramStep &program_step = programs[k].at(bot.location);
       std::vector<Direction> nexts;
-      if (op.type == Operation::Type::BRANCH) nexts.push_back(op.direction);
-      Direction direction = directions[k].at(bot.location);
-      if (!direction) direction = bot.moving;
+      if (program_step.operation.type == Operation::Type::BRANCH) nexts.push_back(program_step.operation.direction);
+      Direction direction = program_step.next(bot.moving);
       if (!direction) direction = Bot().moving;
       nexts.push_back(direction);
       for (const Direction &direction : nexts) {
@@ -1191,7 +2126,7 @@ std::vector<Grid<uint8_t>> Board::get_paths() const {
         Bot next(bot);
         next.moving = direction;
         next.location = bot.location + direction;
-        if (paths[k].valid(next.location) && trespassable.at(next.location) && !done.count(next)) {
+        if (!program_step.stops_moving(direction) && !done.count(next)) {
           done.insert(next);
           que.push(next);
         }
@@ -0,0 +1,88 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+using namespace puzzle;
+
+// Write the expected outputs of the checks for the example solutions, without loop detection
+// The checks hold the engine to these, so they are only rewritten for intended changes of behavior.
+
+// Run one test case of the board on its own
+Outcome run_test_case(const Board &board, const std::vector<std::string> &bits, const std::string &colors) {
+  Board single = with_test_cases(board, {bits}, {colors});
+  if (single.check_status() == Status::INVALID) return outcome(single, {false, true});
+  return outcome(single, single.run(MAX_CYCLES));
+}
+
+Expected expected_outputs(const Board &board, std::mt19937 &rng) {
+  Expected expected;
+  // step like run
+  Board stepped = board;
+  for (int cycle=0; cycle<=MAX_CYCLES; ++cycle) {
+    const bool error = cycle ? stepped.move() : stepped.resolve();
+    expected.states.push_back(state_hash(stepped));
+    if (error || stepped.check_status() != Status::RUNNING) break;
+  }
+  // the test cases of the level
+  std::vector<std::vector<std::string>> bits;
+  std::vector<std::string> colors;
+  for (size_t t=0; t<board.get_output_colors().size(); ++t) {
+    bits.emplace_back();
+    for (const auto &input_bits : board.get_input_bits()[t]) {
+      bits.back().emplace_back();
+      for (uint8_t bit : input_bits) bits.back().back() += bit ? '1' : '0';
+    }
+    colors.emplace_back();
+    for (const Color &color : board.get_output_colors()[t]) colors.back() += static_cast<char>(color);
+    expected.test_cases.push_back(run_test_case(board, bits.back(), colors.back()));
+  }
+  // random test cases with the colors of the level
+  std::string palette;
+  for (const std::string &test_case_colors : colors) palette += test_case_colors;
+  for (size_t t=0; t<RANDOM_TEST_CASES; ++t) {
+    const size_t steps = 1 + rng() % MAX_RANDOM_STEPS;
+    expected.random_bits.emplace_back(board.get_inputs().size());
+    for (std::string &input_bits : expected.random_bits.back()) {
+      for (size_t step=0; step<steps; ++step) input_bits += rng() % 2 ? '1' : '0';
+    }
+    expected.random_colors.emplace_back();
+    for (size_t step=0; step<steps; ++step) expected.random_colors.back() += palette[rng() % palette.size()];
+    expected.random_test_cases.push_back(run_test_case(board, expected.random_bits.back(), expected.random_colors.back()));
+  }
+  // runs of all the test cases
+  for (const Board &test_cases : {board, with_test_cases(board, expected.random_bits, expected.random_colors)}) {
+    for (const size_t max_cycles : RUN_CYCLES) {
+      Board run = test_cases;
+      const auto result = run.run(max_cycles);
+      expected.runs.push_back(outcome(run, result));
+      expected.run_states.push_back(state_hash(run));
+    }
+  }
+  return expected;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || argc % 2 == 0) {
+    std::cerr << "Args: level_file submission_file [level_file submission_file ...]" << std::endl;
+    return 1;
+  }
+  for (int i=1; i<argc; i+=2) {
+    Board board = load(read(argv[i]), read(argv[i+1]));
+    board.set_detect_loops(false);
+    if (board.check_status() == Status::INVALID) {
+      std::cerr << argv[i+1] << ": invalid board: " << board.get_error() << std::endl;
+      return 1;
+    }
+    // each example has its own random test cases
+    std::mt19937 rng(1);
+    std::ofstream file(expected_filename(argv[i+1]));
+    write_expected(file, expected_outputs(board, rng));
+    if (!file) {
+      std::cerr << "Could not write " << expected_filename(argv[i+1]) << std::endl;
+      return 1;
+    }
+  }
+}